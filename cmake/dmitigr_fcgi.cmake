@@ -25,33 +25,73 @@ dmitigr_cpplipa_set_library_info(fcgi 1 0 0 "FastCGI library")
 # ------------------------------------------------------------------------------
 
 set(dmitigr_fcgi_headers
+  authorizer_cache.hpp
   basics.hpp
+  body_spool.hpp
+  client.hpp
+  compression.hpp
   connection.hpp
   exceptions.hpp
+  flush_policy.hpp
+  form_fields.hpp
+  gateway.hpp
   listener.hpp
   listener_options.hpp
+  multipart.hpp
+  prepared_response.hpp
+  record_encoder.hpp
+  record_parser.hpp
+  response_cache.hpp
+  response_headers.hpp
   server_connection.hpp
   streambuf.hpp
   streams.hpp
   types_fwd.hpp
+  writer.hpp
   )
 
 set(dmitigr_fcgi_implementations
+  authorizer_cache.cpp
   basics.cpp
+  body_spool.cpp
+  client.cpp
+  compression.cpp
+  flush_policy.cpp
+  form_fields.cpp
+  gateway.cpp
   listener.cpp
   listener_options.cpp
+  multipart.cpp
+  prepared_response.cpp
+  record_encoder.cpp
+  record_parser.cpp
+  response_cache.cpp
+  response_headers.cpp
   server_connection.cpp
   server_connection_stacked.cpp
   streambuf.cpp
   streams.cpp
+  writer.cpp
   )
 
+# ------------------------------------------------------------------------------
+# Dependencies
+# ------------------------------------------------------------------------------
+
+if(DMITIGR_CPPLIPA_ZLIB)
+  find_package(ZLIB REQUIRED)
+  list(APPEND dmitigr_fcgi_target_compile_definitions_public DMITIGR_FCGI_ZLIB)
+  list(APPEND dmitigr_fcgi_target_compile_definitions_interface DMITIGR_FCGI_ZLIB)
+  list(APPEND dmitigr_fcgi_target_link_libraries_public ZLIB::ZLIB)
+  list(APPEND dmitigr_fcgi_target_link_libraries_interface ZLIB::ZLIB)
+endif()
+
 # ------------------------------------------------------------------------------
 # Tests
 # ------------------------------------------------------------------------------
 
 if(DMITIGR_CPPLIPA_TESTS)
-  set(dmitigr_fcgi_tests hello hellomt largesend overload)
+  set(dmitigr_fcgi_tests abort authorizer_cache body_spool client compression filter flush_policy form_fields gateway listener multipart nonblocking output_policy prepared_response read_body record_encoder record_parser response_cache response_headers streambuf writer zerocopy hello hellomt largesend overload)
   set(dmitigr_fcgi_tests_target_link_libraries dmitigr_base dmitigr_rnd)
   if(UNIX)
     list(APPEND dmitigr_fcgi_tests_target_link_libraries pthread)
@@ -0,0 +1,130 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "authorizer_cache.hpp"
+#include "connection.hpp"
+#include "exceptions.hpp"
+#include "prepared_response.hpp"
+#include "response_headers.hpp"
+#include "server_connection.hpp"
+
+#include <utility>
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Authorizer_cache::Authorizer_cache(
+  std::vector<std::string> parameters,
+  const std::chrono::milliseconds allow_ttl,
+  const std::chrono::milliseconds deny_ttl,
+  const std::size_t memory_limit, const std::size_t shard_count)
+  : allow_ttl_{allow_ttl}
+  , deny_ttl_{deny_ttl}
+  , allow_response_{std::make_shared<const Prepared_response>(
+      Response_headers{200}, std::string_view{})}
+  , deny_response_{std::make_shared<const Prepared_response>(
+      Response_headers{403}, std::string_view{})}
+  , cache_{std::move(parameters), memory_limit, shard_count}
+{}
+
+DMITIGR_FCGI_INLINE const std::vector<std::string>&
+Authorizer_cache::parameters() const noexcept
+{
+  return cache_.parameters();
+}
+
+DMITIGR_FCGI_INLINE std::chrono::milliseconds
+Authorizer_cache::allow_ttl() const noexcept
+{
+  return allow_ttl_;
+}
+
+DMITIGR_FCGI_INLINE std::chrono::milliseconds
+Authorizer_cache::deny_ttl() const noexcept
+{
+  return deny_ttl_;
+}
+
+DMITIGR_FCGI_INLINE const Prepared_response&
+Authorizer_cache::allow_response() const noexcept
+{
+  return *allow_response_;
+}
+
+DMITIGR_FCGI_INLINE const Prepared_response&
+Authorizer_cache::deny_response() const noexcept
+{
+  return *deny_response_;
+}
+
+DMITIGR_FCGI_INLINE std::string
+Authorizer_cache::key(const Connection& conn) const
+{
+  return cache_.key(conn);
+}
+
+DMITIGR_FCGI_INLINE std::optional<bool>
+Authorizer_cache::find(const std::string& key)
+{
+  if (const auto response = cache_.find(key))
+    return response == allow_response_;
+  else
+    return std::nullopt;
+}
+
+DMITIGR_FCGI_INLINE bool
+Authorizer_cache::insert(std::string key, const bool is_authorized)
+{
+  return is_authorized ?
+    cache_.insert(std::move(key), allow_response_, allow_ttl_) :
+    cache_.insert(std::move(key), deny_response_, deny_ttl_);
+}
+
+DMITIGR_FCGI_INLINE bool
+Authorizer_cache::serve(Server_connection& conn, const Handler& handler)
+{
+  if (conn.role() != Role::authorizer)
+    throw Exception{"cannot serve request of non-authorizer role by"
+      " FastCGI authorizer cache"};
+  else if (!handler)
+    throw Exception{"cannot serve request by FastCGI authorizer cache"
+      " without decision handler"};
+
+  auto key = this->key(conn);
+  auto is_authorized = find(key);
+  if (!is_authorized) {
+    is_authorized = handler(conn);
+    insert(std::move(key), *is_authorized);
+  }
+  conn.send(*is_authorized ? *allow_response_ : *deny_response_);
+  return *is_authorized;
+}
+
+DMITIGR_FCGI_INLINE bool Authorizer_cache::erase(const std::string& key)
+{
+  return cache_.erase(key);
+}
+
+DMITIGR_FCGI_INLINE void Authorizer_cache::clear()
+{
+  cache_.clear();
+}
+
+DMITIGR_FCGI_INLINE std::size_t Authorizer_cache::size() const
+{
+  return cache_.size();
+}
+
+} // namespace dmitigr::fcgi
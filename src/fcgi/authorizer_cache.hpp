@@ -0,0 +1,157 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_AUTHORIZER_CACHE_HPP
+#define DMITIGR_FCGI_AUTHORIZER_CACHE_HPP
+
+#include "dll.hpp"
+#include "response_cache.hpp"
+#include "types_fwd.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief The cache of the decisions of the application of the Authorizer role.
+ *
+ * @details The decisions are keyed by the values of the selected parameters
+ * of the request (for example, `HTTP_AUTHORIZATION` and `REQUEST_URI`) and
+ * expire after the time-to-live of the allowing or of the denying decision
+ * respectively. Both decisions are answered by the responses prepared once
+ * upon the construction (`Status: 200` and `Status: 403` with the empty
+ * body), which are shared by all the cached entries, so a hit costs a single
+ * lookup and a single write. The decisions are stored in the sharded
+ * Response_cache, thus the instance can be shared between the threads which
+ * serve the connections, for example:
+ * @code
+ * if (const auto conn = listener.accept()) {
+ *   cache.serve(*conn, [](Server_connection& conn)
+ *   {
+ *     return check_credentials(conn["HTTP_AUTHORIZATION"]);
+ *   });
+ * }
+ * @endcode
+ */
+class Authorizer_cache final {
+public:
+  /**
+   * @brief The decision handler.
+   *
+   * @details The handler may read the parameters of the request, but must
+   * not write the response.
+   *
+   * @returns `true` if the request is authorized.
+   */
+  using Handler = std::function<bool(Server_connection&)>;
+
+  /**
+   * @brief The constructor.
+   *
+   * @param parameters The names of the parameters the key consists of.
+   * @param allow_ttl The time-to-live of the allowing decisions.
+   * @param deny_ttl The time-to-live of the denying decisions.
+   * @param memory_limit The maximum total size of the cached decisions.
+   * @param shard_count The number of shards.
+   *
+   * @par Requires
+   * `shard_count > 0`.
+   */
+  DMITIGR_FCGI_API Authorizer_cache(std::vector<std::string> parameters,
+    std::chrono::milliseconds allow_ttl, std::chrono::milliseconds deny_ttl,
+    std::size_t memory_limit, std::size_t shard_count = 16);
+
+  /// @returns The names of the parameters the key consists of.
+  DMITIGR_FCGI_API const std::vector<std::string>& parameters() const noexcept;
+
+  /// @returns The time-to-live of the allowing decisions.
+  DMITIGR_FCGI_API std::chrono::milliseconds allow_ttl() const noexcept;
+
+  /// @returns The time-to-live of the denying decisions.
+  DMITIGR_FCGI_API std::chrono::milliseconds deny_ttl() const noexcept;
+
+  /// @returns The response of the allowing decision.
+  DMITIGR_FCGI_API const Prepared_response& allow_response() const noexcept;
+
+  /// @returns The response of the denying decision.
+  DMITIGR_FCGI_API const Prepared_response& deny_response() const noexcept;
+
+  /// @returns The key of the request of `conn`.
+  DMITIGR_FCGI_API std::string key(const Connection& conn) const;
+
+  /**
+   * @returns The unexpired decision by the `key` (`true` if the request is
+   * authorized), or `std::nullopt` if there is no such a decision.
+   */
+  DMITIGR_FCGI_API std::optional<bool> find(const std::string& key);
+
+  /**
+   * @brief Caches the decision by the `key`, replacing the decision cached
+   * by the `key` before (if any).
+   *
+   * @returns `false` if the decision is not cached because of the memory
+   * limit.
+   */
+  DMITIGR_FCGI_API bool insert(std::string key, bool is_authorized);
+
+  /**
+   * @brief Answers the request of `conn` by the cached decision, or by the
+   * decision of `handler` which is cached then.
+   *
+   * @returns `true` if the request is authorized.
+   *
+   * @par Requires
+   * `conn.role() == Role::authorizer && handler`.
+   *
+   * @par Exception safety guarantee
+   * Basic. The decision is not cached if `handler` throws.
+   */
+  DMITIGR_FCGI_API bool serve(Server_connection& conn, const Handler& handler);
+
+  /**
+   * @brief Removes the decision by the `key`.
+   *
+   * @returns `true` if the decision was removed.
+   */
+  DMITIGR_FCGI_API bool erase(const std::string& key);
+
+  /// Removes all the decisions.
+  DMITIGR_FCGI_API void clear();
+
+  /// @returns The number of the cached decisions (including the expired ones).
+  DMITIGR_FCGI_API std::size_t size() const;
+
+private:
+  std::chrono::milliseconds allow_ttl_{};
+  std::chrono::milliseconds deny_ttl_{};
+  std::shared_ptr<const Prepared_response> allow_response_;
+  std::shared_ptr<const Prepared_response> deny_response_;
+  Response_cache cache_;
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "authorizer_cache.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_AUTHORIZER_CACHE_HPP
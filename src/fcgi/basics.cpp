@@ -29,6 +29,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace dmitigr::fcgi::detail {
@@ -218,6 +219,14 @@ struct Begin_request_body final {
   /// The default constructor.
   Begin_request_body() = default;
 
+  /// The constructor.
+  Begin_request_body(const Role role, const bool is_keep_conn) noexcept
+    : role_b1_{static_cast<unsigned char>((static_cast<int>(role) >> 8) & 0xff)}
+    , role_b0_{static_cast<unsigned char>( static_cast<int>(role)       & 0xff)}
+    , flags_{static_cast<unsigned char>(is_keep_conn ?
+        static_cast<unsigned char>(Flags::keep_conn) : 0)}
+  {}
+
   /// Constructs by reading the record from `io`.
   explicit Begin_request_body(net::Descriptor* const io)
   {
@@ -265,6 +274,21 @@ struct End_request_body final {
     , protocol_status_{static_cast<unsigned char>(protocol_status)}
   {}
 
+  /// @returns The application status.
+  int application_status() const noexcept
+  {
+    return static_cast<int>(static_cast<unsigned>(application_status_b3_) << 24 |
+      static_cast<unsigned>(application_status_b2_) << 16 |
+      static_cast<unsigned>(application_status_b1_) << 8 |
+      static_cast<unsigned>(application_status_b0_));
+  }
+
+  /// @returns The protocol status.
+  Protocol_status protocol_status() const noexcept
+  {
+    return Protocol_status{protocol_status_};
+  }
+
 private:
   unsigned char application_status_b3_{};
   unsigned char application_status_b2_{};
@@ -477,4 +501,63 @@ private:
   std::vector<Name_value> pairs_;
 };
 
+/// Appends the length of a name or value of a name-value pair to `result`.
+inline void append_name_value_length(std::string& result, const std::size_t length)
+{
+  if (length <= 127)
+    result.push_back(static_cast<char>(length));
+  else if (length <= 0x7fffffff) {
+    result.push_back(static_cast<char>(((length >> 24) & 0x7f) | 0x80));
+    result.push_back(static_cast<char>((length >> 16) & 0xff));
+    result.push_back(static_cast<char>((length >> 8) & 0xff));
+    result.push_back(static_cast<char>(length & 0xff));
+  } else
+    throw Exception{"FastCGI parameter is too long"};
+}
+
+/// Appends the name-value pair to `result`.
+inline void append_name_value(std::string& result, const std::string_view name,
+  const std::string_view value)
+{
+  append_name_value_length(result, name.size());
+  append_name_value_length(result, value.size());
+  result.append(name).append(value);
+}
+
+/**
+ * @returns The get-values-result record which answers the `variables` of the
+ * get-values record.
+ *
+ * @details Both `FCGI_MAX_CONNS` and `FCGI_MAX_REQS` are answered with the
+ * `max_request_count`, since each connection serves one request at a time,
+ * and `FCGI_MPXS_CONNS` is answered with `0`. The other variables are ignored.
+ */
+inline std::string get_values_result(const Names_values& variables,
+  const std::size_t max_request_count)
+{
+  const auto max_count = std::to_string(max_request_count);
+  std::string content;
+  for (std::size_t i{}; i < variables.pair_count(); ++i) {
+    const auto name = variables.pair(i).name();
+    std::string_view value;
+    if (name == "FCGI_MAX_CONNS" || name == "FCGI_MAX_REQS")
+      value = max_count;
+    else if (name == "FCGI_MPXS_CONNS")
+      value = "0";
+    else
+      continue;
+
+    // The lengths of the known names and values are less than 128.
+    content.push_back(static_cast<char>(name.size()));
+    content.push_back(static_cast<char>(value.size()));
+    content.append(name).append(value);
+  }
+
+  const Header header{Record_type::get_values_result, Header::null_request_id,
+    content.size()};
+  std::string result{reinterpret_cast<const char*>(&header), sizeof(header)};
+  result.append(content).append(header.padding_length(), '\0');
+  return result;
+}
+
 } // namespace dmitigr::fcgi::detail
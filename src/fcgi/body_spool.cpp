@@ -0,0 +1,281 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../base/assert.hpp"
+#include "../os/exceptions.hpp"
+#include "body_spool.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <streambuf>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace dmitigr::fcgi::detail {
+
+/// The seekable read-only stream buffer over a contiguous memory area.
+class Span_streambuf final : public std::streambuf {
+public:
+  /// The constructor.
+  Span_streambuf(const char* const data, const std::size_t size)
+  {
+    auto* const begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+  }
+
+protected:
+  pos_type seekoff(const off_type off, const std::ios_base::seekdir dir,
+    const std::ios_base::openmode which) override
+  {
+    if (!(which & std::ios_base::in) || (which & std::ios_base::out))
+      return pos_type(off_type(-1));
+
+    const off_type base = dir == std::ios_base::beg ? 0 :
+      dir == std::ios_base::cur ? gptr() - eback() : egptr() - eback();
+    const off_type pos = base + off;
+    if (pos < 0 || pos > egptr() - eback())
+      return pos_type(off_type(-1));
+
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+  }
+
+  pos_type seekpos(const pos_type pos,
+    const std::ios_base::openmode which) override
+  {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+#ifndef _WIN32
+/// @returns The descriptor of a new anonymous file in `directory`.
+inline int make_anonymous_file(const std::filesystem::path& directory)
+{
+  const auto dir = directory.empty() ?
+    std::filesystem::temp_directory_path() : directory;
+#ifdef O_TMPFILE
+  if (const int fd = ::open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC,
+      S_IRUSR | S_IWUSR); fd >= 0)
+    return fd;
+#endif
+#ifdef MFD_CLOEXEC
+  // Note, that memfd is backed by memory but it is swappable at least.
+  if (const int fd = ::memfd_create("dmitigr_fcgi_body", MFD_CLOEXEC); fd >= 0)
+    return fd;
+#endif
+  auto path = (dir / "dmitigr_fcgi_body_XXXXXX").string();
+  const int fd = ::mkstemp(path.data());
+  if (fd < 0)
+    throw os::Sys_exception{"cannot create FastCGI body spool file"};
+  ::unlink(path.c_str());
+  return fd;
+}
+#endif
+
+} // namespace dmitigr::fcgi::detail
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Body_spool::~Body_spool()
+{
+#ifndef _WIN32
+  unmap();
+  if (file_ >= 0)
+    ::close(file_);
+#endif
+}
+
+DMITIGR_FCGI_INLINE Body_spool::Body_spool(const std::size_t memory_limit,
+  std::filesystem::path directory)
+  : memory_limit_{memory_limit}
+  , directory_{std::move(directory)}
+  , stream_{nullptr}
+{}
+
+DMITIGR_FCGI_INLINE std::size_t Body_spool::memory_limit() const noexcept
+{
+  return memory_limit_;
+}
+
+DMITIGR_FCGI_INLINE std::size_t Body_spool::size() const noexcept
+{
+  return size_;
+}
+
+DMITIGR_FCGI_INLINE bool Body_spool::is_spilled() const noexcept
+{
+  return file_ >= 0;
+}
+
+DMITIGR_FCGI_INLINE void Body_spool::reserve(const std::size_t size)
+{
+#ifndef _WIN32
+  if (size > memory_limit_) {
+    if (!is_spilled())
+      spill();
+#ifdef FALLOC_FL_KEEP_SIZE
+    // Allocating the blocks of the file in advance (if supported).
+    (void)::fallocate(file_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+#endif
+    return;
+  }
+#endif
+  if (!is_spilled())
+    memory_.reserve(size);
+}
+
+DMITIGR_FCGI_INLINE void Body_spool::append(const char* const data,
+  const std::size_t size)
+{
+  if (!size)
+    return;
+  else if (!data)
+    throw Exception{"cannot append null data to FastCGI body spool"};
+
+  stream_.rdbuf(nullptr);
+  streambuf_.reset();
+#ifndef _WIN32
+  if (!is_spilled() && memory_.size() + size > memory_limit_)
+    spill();
+#endif
+  if (is_spilled()) {
+    unmap();
+    write_file(data, size);
+  } else
+    memory_.append(data, size);
+  size_ += size;
+}
+
+DMITIGR_FCGI_INLINE std::size_t Body_spool::append(std::istream& in,
+  const std::size_t max_size)
+{
+  std::size_t result{};
+  std::array<char, 16384> chunk;
+  while (in) {
+    /*
+     * Until the memory limit is reached, the data is read straight into the
+     * memory (in bulk up to the capacity reserved by reserve()), bypassing
+     * the chunk.
+     */
+    if (!is_spilled() && size_ < memory_limit_) {
+      stream_.rdbuf(nullptr);
+      streambuf_.reset();
+      auto capacity = std::min(memory_limit_ - size_,
+        std::max(memory_.capacity() - size_, chunk.size()));
+      if (const auto rest = max_size - result; rest < capacity)
+        capacity = rest + 1; // to detect the excess
+      memory_.resize(size_ + capacity);
+      in.read(memory_.data() + size_, static_cast<std::streamsize>(capacity));
+      const auto count = static_cast<std::size_t>(in.gcount());
+      memory_.resize(size_ + count);
+      size_ += count;
+      if (count > max_size - result)
+        throw Exception{"FastCGI body is too large to spool"};
+      result += count;
+      continue;
+    }
+
+    in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    const auto count = static_cast<std::size_t>(in.gcount());
+    if (count > max_size - result)
+      throw Exception{"FastCGI body is too large to spool"};
+    append(chunk.data(), count);
+    result += count;
+  }
+  return result;
+}
+
+DMITIGR_FCGI_INLINE std::string_view Body_spool::view()
+{
+  if (!is_spilled() || !size_)
+    return memory_;
+
+#ifndef _WIN32
+  if (!map_) {
+    void* const map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_, 0);
+    if (map == MAP_FAILED)
+      throw os::Sys_exception{"cannot map FastCGI body spool file"};
+    map_ = map;
+    map_size_ = size_;
+  }
+#endif
+  DMITIGR_ASSERT(map_size_ == size_);
+  return {static_cast<const char*>(map_), map_size_};
+}
+
+DMITIGR_FCGI_INLINE std::istream& Body_spool::stream()
+{
+  const auto data = view();
+  streambuf_ = std::make_unique<detail::Span_streambuf>(data.data(), data.size());
+  stream_.rdbuf(streambuf_.get());
+  return stream_;
+}
+
+DMITIGR_FCGI_INLINE int Body_spool::file_descriptor() const noexcept
+{
+  return file_;
+}
+
+DMITIGR_FCGI_INLINE void Body_spool::spill()
+{
+#ifndef _WIN32
+  DMITIGR_ASSERT(!is_spilled());
+  file_ = detail::make_anonymous_file(directory_);
+  write_file(memory_.data(), memory_.size());
+  std::string{}.swap(memory_);
+#endif
+}
+
+DMITIGR_FCGI_INLINE void Body_spool::unmap()
+{
+#ifndef _WIN32
+  if (map_) {
+    ::munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+  }
+#endif
+}
+
+DMITIGR_FCGI_INLINE void Body_spool::write_file(const char* data,
+  std::size_t size)
+{
+#ifndef _WIN32
+  DMITIGR_ASSERT(is_spilled());
+  while (size) {
+    const auto count = ::write(file_, data, size);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      throw os::Sys_exception{"cannot write FastCGI body spool file"};
+    }
+    data += count;
+    size -= static_cast<std::size_t>(count);
+  }
+#else
+  (void)data;
+  (void)size;
+#endif
+}
+
+} // namespace dmitigr::fcgi
@@ -0,0 +1,162 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_BODY_SPOOL_HPP
+#define DMITIGR_FCGI_BODY_SPOOL_HPP
+
+#include "../fs/filesystem.hpp"
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <cstddef>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief A spool of a request body.
+ *
+ * @details The body is kept in memory up to the memory limit. Upon exceeding
+ * it, the body is spilled to an anonymous file (created with `O_TMPFILE` or,
+ * if not supported, with `memfd_create()`) so the memory usage is bounded
+ * regardless of the body size.
+ *
+ * @remarks On Windows the body is always kept in memory.
+ */
+class Body_spool final {
+public:
+  /// The default memory limit.
+  static constexpr std::size_t default_memory_limit{1048576};
+
+  /// The destructor.
+  DMITIGR_FCGI_API ~Body_spool();
+
+  /// Non copy-constructible.
+  Body_spool(const Body_spool&) = delete;
+
+  /// Non copy-assignable.
+  Body_spool& operator=(const Body_spool&) = delete;
+
+  /// Non move-constructible.
+  Body_spool(Body_spool&&) = delete;
+
+  /// Non move-assignable.
+  Body_spool& operator=(Body_spool&&) = delete;
+
+  /**
+   * @brief The constructor.
+   *
+   * @param memory_limit The maximum size of the body to keep in memory.
+   * @param directory The directory of the file to spill the body to. The
+   * empty path denotes the directory for temporary files.
+   */
+  DMITIGR_FCGI_API explicit Body_spool(
+    std::size_t memory_limit = default_memory_limit,
+    std::filesystem::path directory = {});
+
+  /// @returns The maximum size of the body to keep in memory.
+  DMITIGR_FCGI_API std::size_t memory_limit() const noexcept;
+
+  /// @returns The size of the spooled body.
+  DMITIGR_FCGI_API std::size_t size() const noexcept;
+
+  /// @returns `true` if the body is spilled to the file.
+  DMITIGR_FCGI_API bool is_spilled() const noexcept;
+
+  /**
+   * @brief Prepares the spool for the body of the given expected `size` (for
+   * example, the value of `CONTENT_LENGTH` parameter).
+   *
+   * @details If `size` exceeds the memory limit the body is spilled to the
+   * file in advance (and the blocks of the file are allocated if supported),
+   * otherwise the memory for the body is reserved.
+   */
+  DMITIGR_FCGI_API void reserve(std::size_t size);
+
+  /**
+   * @brief Appends `size` bytes of `data` to the body.
+   *
+   * @par Effects
+   * The result of view() and stream() are invalidated.
+   */
+  DMITIGR_FCGI_API void append(const char* data, std::size_t size);
+
+  /**
+   * @overload
+   *
+   * @details Appends the data read from `in` until the end of stream. While
+   * the body fits in memory, the data is read straight into the memory in
+   * bulk (up to the size reserved by reserve()).
+   *
+   * @param max_size The maximum number of bytes to read from `in`.
+   *
+   * @returns The number of bytes appended.
+   *
+   * @throws Exception if the stream contains more than `max_size` bytes.
+   */
+  DMITIGR_FCGI_API std::size_t append(std::istream& in,
+    std::size_t max_size = std::numeric_limits<std::size_t>::max());
+
+  /**
+   * @returns The view of the body. If the body is spilled to the file, the
+   * file is mapped into memory.
+   *
+   * @remarks The view is valid until the next modification of the spool.
+   */
+  DMITIGR_FCGI_API std::string_view view();
+
+  /**
+   * @returns The seekable stream to read the body from the beginning.
+   *
+   * @remarks The stream is valid until the next modification of the spool.
+   *
+   * @see view().
+   */
+  DMITIGR_FCGI_API std::istream& stream();
+
+  /**
+   * @returns The descriptor of the file the body is spilled to, or `-1`
+   * if `!is_spilled()`.
+   */
+  DMITIGR_FCGI_API int file_descriptor() const noexcept;
+
+private:
+  std::size_t memory_limit_{};
+  std::size_t size_{};
+  std::filesystem::path directory_;
+  std::string memory_;
+  int file_{-1};
+  void* map_{};
+  std::size_t map_size_{};
+  std::unique_ptr<detail::Span_streambuf> streambuf_;
+  std::istream stream_;
+
+  void spill();
+  void unmap();
+  void write_file(const char* data, std::size_t size);
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "body_spool.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_BODY_SPOOL_HPP
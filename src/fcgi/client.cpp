@@ -0,0 +1,450 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../base/assert.hpp"
+#include "../net/descriptor.hpp"
+#include "basics.hpp"
+#include "client.hpp"
+#include "exceptions.hpp"
+#include "record_encoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <sstream>
+
+namespace dmitigr::fcgi::detail {
+
+/// The state of a request performed by Client.
+struct Client_request_state final {
+  Client_response response;
+  Protocol_status protocol_status{};
+  bool is_started{}; // at least one record is received
+  bool is_done{}; // the end-request record is received
+};
+
+/**
+ * @brief Reads exactly `size` bytes from `io` into `buf`.
+ *
+ * @throws Exception if the connection is closed by the application.
+ */
+inline void read_exactly(net::Descriptor& io, char* buf, std::size_t size)
+{
+  while (size) {
+    const auto count = io.read(buf, static_cast<std::streamsize>(
+      std::min<std::size_t>(size, std::numeric_limits<int>::max())));
+    if (count <= 0)
+      throw Exception{"FastCGI connection closed by application"};
+    buf += count;
+    size -= static_cast<std::size_t>(count);
+  }
+}
+
+/// Reads and discards `size` bytes from `io`.
+inline void skip_exactly(net::Descriptor& io, std::size_t size)
+{
+  std::array<char, 4096> buf;
+  while (size) {
+    const auto count = std::min(size, buf.size());
+    read_exactly(io, buf.data(), count);
+    size -= count;
+  }
+}
+
+/// A connection of Client.
+class Client_connection final {
+public:
+  /// The number of requests in progress. (Guarded by the mutex of Client.)
+  std::size_t request_count{};
+
+  /// The number of completed requests. (Guarded by the mutex of Client.)
+  std::size_t completed_count{};
+
+  /// The constructor.
+  explicit Client_connection(std::unique_ptr<net::Descriptor> io)
+    : io_{std::move(io)}
+  {
+    DMITIGR_ASSERT(io_);
+  }
+
+  /// @returns The descriptor.
+  net::Descriptor& io() noexcept
+  {
+    return *io_;
+  }
+
+  /**
+   * @brief Registers the `state` of a new request.
+   *
+   * @returns The ID of the request which is not used by other requests in
+   * progress over this connection.
+   */
+  int add(Client_request_state& state)
+  {
+    const std::lock_guard lg{mutex_};
+    do {
+      last_request_id_ = last_request_id_ % 65535 + 1;
+    } while (states_.count(last_request_id_));
+    states_.emplace(last_request_id_, &state);
+    return last_request_id_;
+  }
+
+  /// Unregisters the state of the request.
+  void remove(const int request_id)
+  {
+    const std::lock_guard lg{mutex_};
+    states_.erase(request_id);
+  }
+
+  /// Writes the `message` of a request.
+  void write(Record_encoder& message)
+  {
+    const std::lock_guard lg{write_mutex_};
+    net::write_all(*io_, message.iovecs(), message.iovec_count());
+  }
+
+  /**
+   * @brief Waits until the `state` is done.
+   *
+   * @details The records are read by one of the waiting threads at a time,
+   * which dispatches them to the states of the requests in progress.
+   *
+   * @throws Exception if the connection is broken.
+   */
+  void wait(Client_request_state& state)
+  {
+    std::unique_lock lk{mutex_};
+    while (!state.is_done) {
+      if (is_broken_)
+        throw Exception{error_};
+      else if (is_reading_) {
+        state_changed_.wait(lk);
+        continue;
+      }
+
+      is_reading_ = true;
+      lk.unlock();
+      std::string error;
+      try {
+        read_record();
+      } catch (const std::exception& e) {
+        error = e.what();
+      } catch (...) {
+        error = "unknown error upon reading FastCGI response";
+      }
+      lk.lock();
+      is_reading_ = false;
+      if (!error.empty()) {
+        is_broken_ = true;
+        error_ = std::move(error);
+      }
+      state_changed_.notify_all();
+    }
+  }
+
+  /// @returns `true` if the connection is broken.
+  bool is_broken() const
+  {
+    const std::lock_guard lg{mutex_};
+    return is_broken_;
+  }
+
+  /**
+   * @returns `true` if the idle connection is readable, which means that it's
+   * closed by the application.
+   */
+  bool is_stale() const
+  {
+    using Sr = net::Socket_readiness;
+    const auto socket = static_cast<net::Socket_native>(io_->native_handle());
+    return net::poll(socket, Sr::read_ready, std::chrono::milliseconds{0}) !=
+      Sr::unready;
+  }
+
+private:
+  std::unique_ptr<net::Descriptor> io_;
+  mutable std::mutex mutex_;
+  std::condition_variable state_changed_;
+  std::map<int, Client_request_state*> states_;
+  int last_request_id_{};
+  bool is_reading_{};
+  bool is_broken_{};
+  std::string error_;
+  std::mutex write_mutex_;
+
+  /**
+   * @brief Reads the record and dispatches it to the state of the request.
+   *
+   * @details The content of the output streams is read right into the
+   * response, since its owner doesn't touch it until the state is done.
+   */
+  void read_record()
+  {
+    Header header;
+    read_exactly(*io_, reinterpret_cast<char*>(&header), sizeof(header));
+    header.check_validity();
+    const auto content_length = header.content_length();
+    const auto padding_length = header.padding_length();
+    const auto type = header.record_type();
+
+    Client_request_state* state{};
+    {
+      const std::lock_guard lg{mutex_};
+      if (const auto i = states_.find(header.request_id()); i != states_.end()) {
+        state = i->second;
+        state->is_started = true;
+      }
+    }
+
+    if (state && (type == Record_type::out || type == Record_type::err)) {
+      auto& content = type == Record_type::out ?
+        state->response.out : state->response.err;
+      const auto size = content.size();
+      content.resize(size + content_length);
+      read_exactly(*io_, content.data() + size, content_length);
+      skip_exactly(*io_, padding_length);
+    } else if (state && type == Record_type::end_request &&
+      content_length == sizeof(End_request_body)) {
+      End_request_body body;
+      read_exactly(*io_, reinterpret_cast<char*>(&body), sizeof(body));
+      skip_exactly(*io_, padding_length);
+      const std::lock_guard lg{mutex_};
+      state->response.application_status = body.application_status();
+      state->protocol_status = body.protocol_status();
+      state->is_done = true;
+    } else
+      skip_exactly(*io_, content_length + padding_length);
+  }
+};
+
+} // namespace dmitigr::fcgi::detail
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Client::Client(net::Client_options options,
+  const std::size_t max_connection_count)
+  : options_{std::move(options)}
+  , max_connection_count_{max_connection_count}
+{
+  if (!max_connection_count)
+    throw Exception{"invalid maximum number of FastCGI client connections"};
+}
+
+DMITIGR_FCGI_INLINE Client::~Client() = default;
+
+DMITIGR_FCGI_INLINE const net::Client_options& Client::options() const noexcept
+{
+  return options_;
+}
+
+DMITIGR_FCGI_INLINE Client_response Client::request(const Parameters& parameters,
+  const std::string_view in, const Role role)
+{
+  if (role == Role::filter)
+    throw Exception{"FastCGI Filter role is not supported by client"};
+
+  std::string params;
+  for (const auto& [name, value] : parameters)
+    detail::append_name_value(params, name, value);
+
+  while (true) {
+    bool is_reused{};
+    const auto connection = acquire(is_reused);
+    detail::Client_request_state state;
+    const int request_id = connection->add(state);
+    try {
+      // The input is written straight from `in`.
+      Record_encoder message;
+      message.append_begin_request(request_id, role, true)
+        .append_stream(Stream_type::params, request_id, params)
+        .append_end_of_stream(Stream_type::params, request_id)
+        .append_stream(Stream_type::in, request_id, in)
+        .append_end_of_stream(Stream_type::in, request_id);
+      connection->write(message);
+      connection->wait(state);
+    } catch (const std::exception&) {
+      connection->remove(request_id);
+      release(connection, true);
+      if (is_reused && !state.is_started)
+        continue;
+      throw;
+    }
+    connection->remove(request_id);
+    release(connection, false);
+
+    using detail::Protocol_status;
+    switch (state.protocol_status) {
+    case Protocol_status::request_complete:
+      return std::move(state.response);
+    case Protocol_status::cant_mpx_conn:
+      throw Exception{"FastCGI request rejected: cannot multiplex connection"};
+    case Protocol_status::overloaded:
+      throw Exception{"FastCGI request rejected: application is overloaded"};
+    case Protocol_status::unknown_role:
+      throw Exception{"FastCGI request rejected: unknown role"};
+    }
+    throw Exception{"FastCGI request rejected: unknown protocol status"};
+  }
+}
+
+DMITIGR_FCGI_INLINE std::size_t Client::connection_count() const
+{
+  const std::lock_guard lg{mutex_};
+  return connections_.size();
+}
+
+DMITIGR_FCGI_INLINE bool Client::is_multiplexing() const
+{
+  const std::lock_guard lg{mutex_};
+  return is_multiplexing_;
+}
+
+DMITIGR_FCGI_INLINE std::shared_ptr<detail::Client_connection>
+Client::acquire(bool& is_reused)
+{
+  std::unique_lock lk{mutex_};
+  while (true) {
+    // Dropping the broken connections and the idle ones closed by application.
+    connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+      [](const auto& c)
+      {
+        return c->is_broken() || (!c->request_count && c->is_stale());
+      }), connections_.end());
+
+    // Looking for the least loaded connection.
+    detail::Client_connection* best{};
+    std::shared_ptr<detail::Client_connection> result;
+    for (const auto& c : connections_) {
+      if (c->request_count < max_request_count_ &&
+        (!best || c->request_count < best->request_count)) {
+        best = c.get();
+        result = c;
+      }
+    }
+    const bool is_full =
+      connections_.size() + connecting_count_ >= max_connection_count_;
+    if (best && (!best->request_count || is_full)) {
+      ++best->request_count;
+      is_reused = best->completed_count > 0;
+      return result;
+    } else if (!is_full) {
+      const bool is_probe = !is_probed_;
+      is_probed_ = true;
+      ++connecting_count_;
+      lk.unlock();
+      std::shared_ptr<detail::Client_connection> connection;
+      try {
+        connection = connect(is_probe);
+      } catch (...) {
+        lk.lock();
+        --connecting_count_;
+        if (is_probe)
+          is_probed_ = false;
+        connection_released_.notify_all();
+        throw;
+      }
+      lk.lock();
+      --connecting_count_;
+      connections_.push_back(std::move(connection));
+    } else
+      connection_released_.wait(lk);
+  }
+}
+
+DMITIGR_FCGI_INLINE void
+Client::release(const std::shared_ptr<detail::Client_connection>& connection,
+  const bool is_broken)
+{
+  const std::lock_guard lg{mutex_};
+  DMITIGR_ASSERT(connection->request_count);
+  --connection->request_count;
+  if (is_broken) {
+    connections_.erase(std::remove(connections_.begin(), connections_.end(),
+      connection), connections_.end());
+  } else {
+    ++connection->completed_count;
+    // Closing the idle connection closed by the application without delay.
+    if (!connection->request_count && connection->is_stale())
+      connections_.erase(std::remove(connections_.begin(), connections_.end(),
+        connection), connections_.end());
+  }
+  connection_released_.notify_all();
+}
+
+DMITIGR_FCGI_INLINE std::shared_ptr<detail::Client_connection>
+Client::connect(const bool is_probe)
+{
+  const auto make_connection = [this]
+  {
+    auto io = net::make_tcp_connection(options_);
+    if (options_.endpoint().communication_mode() == net::Communication_mode::net)
+      net::set_tcp_nodelay(static_cast<net::Socket_native>(io->native_handle()),
+        true);
+    return std::make_shared<detail::Client_connection>(std::move(io));
+  };
+
+  auto result = make_connection();
+  if (!is_probe)
+    return result;
+
+  // Querying the capacity of the application.
+  Record_encoder message;
+  message.append_get_values({"FCGI_MAX_CONNS", "FCGI_MAX_REQS",
+    "FCGI_MPXS_CONNS"});
+  result->write(message);
+
+  detail::Header header;
+  try {
+    detail::read_exactly(result->io(), reinterpret_cast<char*>(&header),
+      sizeof(header));
+    header.check_validity();
+  } catch (const Exception&) {
+    return make_connection(); // the application closed the connection
+  }
+  if (header.record_type() != detail::Record_type::get_values_result)
+    return make_connection(); // the application rejected the query
+
+  std::string content(header.content_length(), '\0');
+  detail::read_exactly(result->io(), content.data(), content.size());
+  detail::skip_exactly(result->io(), header.padding_length());
+  std::istringstream stream{std::move(content)};
+  const detail::Names_values values{stream};
+  const auto value = [&values](const std::string_view name) -> std::size_t
+  {
+    std::size_t result{};
+    if (const auto index = values.pair_index(name)) {
+      const auto str = values.pair(*index).value();
+      std::from_chars(str.data(), str.data() + str.size(), result);
+    }
+    return result;
+  };
+
+  const std::lock_guard lg{mutex_};
+  if (const auto max_conns = value("FCGI_MAX_CONNS"))
+    max_connection_count_ = std::min(max_connection_count_, max_conns);
+  is_multiplexing_ = value("FCGI_MPXS_CONNS") == 1;
+  if (is_multiplexing_) {
+    const auto max_reqs = value("FCGI_MAX_REQS");
+    max_request_count_ = std::clamp<std::size_t>(
+      max_reqs / max_connection_count_, 1, 65535);
+  }
+  return result;
+}
+
+} // namespace dmitigr::fcgi
@@ -0,0 +1,152 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_CLIENT_HPP
+#define DMITIGR_FCGI_CLIENT_HPP
+
+#include "basics.hpp"
+#include "dll.hpp"
+#include "types_fwd.hpp"
+#include "../net/client.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::fcgi {
+
+/// A response of FastCGI application.
+struct Client_response final {
+  /// The content of the output stream.
+  std::string out;
+
+  /// The content of the error stream.
+  std::string err;
+
+  /// The application status.
+  int application_status{};
+};
+
+/**
+ * @brief A FastCGI client.
+ *
+ * @details The client keeps the pool of persistent connections to the
+ * endpoint of FastCGI application: the requests are sent with the
+ * `keep_conn` flag, and the connection is reused for the subsequent requests
+ * unless the application closed it. Upon the first request, the capacity of
+ * the application is queried by the `FCGI_GET_VALUES` record. If the
+ * application reports `FCGI_MPXS_CONNS=1`, the concurrent requests are
+ * multiplexed over the connections of the pool (the least loaded connection
+ * is used). Otherwise, each connection serves one request at a time.
+ *
+ * @remarks The instance can be shared between threads.
+ */
+class Client final {
+public:
+  /// The parameters of a request.
+  using Parameters = std::vector<std::pair<std::string_view, std::string_view>>;
+
+  /**
+   * @brief The constructor.
+   *
+   * @param options The options of the connections to the application.
+   * @param max_connection_count The maximum number of connections in the
+   * pool. (It's also limited by `FCGI_MAX_CONNS` reported by the application.)
+   *
+   * @par Requires
+   * `max_connection_count > 0`.
+   */
+  DMITIGR_FCGI_API explicit Client(net::Client_options options,
+    std::size_t max_connection_count = 8);
+
+  /// The destructor.
+  DMITIGR_FCGI_API ~Client();
+
+  /// Non copy-constructible.
+  Client(const Client&) = delete;
+
+  /// Non copy-assignable.
+  Client& operator=(const Client&) = delete;
+
+  /// Non move-constructible.
+  Client(Client&&) = delete;
+
+  /// Non move-assignable.
+  Client& operator=(Client&&) = delete;
+
+  /// @returns The options of the connections to the application.
+  DMITIGR_FCGI_API const net::Client_options& options() const noexcept;
+
+  /**
+   * @brief Performs the request.
+   *
+   * @details Waits for a connection of the pool if all of them are busy.
+   * If the request failed on a reused connection before any response is
+   * received (for example, if the application closed the connection), the
+   * connection is dropped and the request is repeated over another one.
+   *
+   * @param parameters The parameters of the request.
+   * @param in The content of the input stream.
+   * @param role The role of the application.
+   *
+   * @returns The response.
+   *
+   * @throws Exception if the request is rejected by the application.
+   *
+   * @par Requires
+   * `role != Role::filter`.
+   */
+  DMITIGR_FCGI_API Client_response request(const Parameters& parameters,
+    std::string_view in = {}, Role role = Role::responder);
+
+  /// @returns The number of connections in the pool.
+  DMITIGR_FCGI_API std::size_t connection_count() const;
+
+  /**
+   * @returns `true` if the application reported the support of multiplexing
+   * of requests over a connection.
+   */
+  DMITIGR_FCGI_API bool is_multiplexing() const;
+
+private:
+  net::Client_options options_;
+  mutable std::mutex mutex_;
+  std::condition_variable connection_released_;
+  std::vector<std::shared_ptr<detail::Client_connection>> connections_;
+  std::size_t connecting_count_{};
+  std::size_t max_connection_count_{};
+  std::size_t max_request_count_{1}; // per connection
+  bool is_multiplexing_{};
+  bool is_probed_{};
+
+  std::shared_ptr<detail::Client_connection> acquire(bool& is_reused);
+  void release(const std::shared_ptr<detail::Client_connection>& connection,
+    bool is_broken);
+  std::shared_ptr<detail::Client_connection> connect(bool is_probe);
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "client.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_CLIENT_HPP
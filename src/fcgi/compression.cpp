@@ -0,0 +1,477 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../base/assert.hpp"
+#include "compression.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#ifdef DMITIGR_FCGI_ZLIB
+#include "server_connection.hpp"
+#include "streams.hpp"
+
+#include <array>
+#include <iostream>
+#include <streambuf>
+
+#include <zlib.h>
+#endif
+
+namespace dmitigr::fcgi::detail {
+
+/// @returns `str` without the leading and trailing spaces.
+inline std::string_view trim_spaces(std::string_view str) noexcept
+{
+  const auto is_space = [](const char c){return c == ' ' || c == '\t';};
+  while (!str.empty() && is_space(str.front()))
+    str.remove_prefix(1);
+  while (!str.empty() && is_space(str.back()))
+    str.remove_suffix(1);
+  return str;
+}
+
+/// @returns `true` if `a` and `b` are equal case-insensitively.
+inline bool is_equal_ci(const std::string_view a,
+  const std::string_view b) noexcept
+{
+  return a.size() == b.size() && std::equal(a.cbegin(), a.cend(), b.cbegin(),
+    [](const char x, const char y)
+    {
+      return std::tolower(static_cast<unsigned char>(x)) ==
+        std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+/**
+ * @returns The quality value of the `params` of an element of
+ * `Accept-Encoding`, or `1` if the quality value is not specified.
+ */
+inline int parse_qvalue(std::string_view params) noexcept
+{
+  while (!params.empty()) {
+    const auto semi = params.find(';');
+    auto param = trim_spaces(params.substr(0, semi));
+    params = semi == std::string_view::npos ?
+      std::string_view{} : params.substr(semi + 1);
+    if (param.size() < 2 || !is_equal_ci(param.substr(0, 2), "q="))
+      continue;
+
+    // The value is converted to thousandths.
+    param = trim_spaces(param.substr(2));
+    int result{};
+    int scale{1000};
+    bool is_fraction{};
+    for (const char c : param) {
+      if (c == '.' && !is_fraction)
+        is_fraction = true;
+      else if ('0' <= c && c <= '9') {
+        if (!is_fraction)
+          result = result*10 + (c - '0')*1000;
+        else if (scale /= 10)
+          result += (c - '0')*scale;
+      } else
+        return 0;
+    }
+    return std::min(result, 1000);
+  }
+  return 1000;
+}
+
+} // namespace dmitigr::fcgi::detail
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE std::string_view to_literal(const Content_coding coding) noexcept
+{
+  switch (coding) {
+  case Content_coding::identity: return "identity";
+  case Content_coding::gzip: return "gzip";
+  case Content_coding::deflate: return "deflate";
+  }
+  DMITIGR_ASSERT(false);
+}
+
+DMITIGR_FCGI_INLINE Content_coding
+negotiate_content_coding(std::string_view accept_encoding) noexcept
+{
+  // The quality values in thousandths (-1 denotes "not mentioned").
+  int gzip{-1};
+  int deflate{-1};
+  int any{-1};
+  while (!accept_encoding.empty()) {
+    const auto comma = accept_encoding.find(',');
+    const auto element = accept_encoding.substr(0, comma);
+    accept_encoding = comma == std::string_view::npos ?
+      std::string_view{} : accept_encoding.substr(comma + 1);
+
+    const auto semi = element.find(';');
+    const auto coding = detail::trim_spaces(element.substr(0, semi));
+    const auto qvalue = semi == std::string_view::npos ? 1000 :
+      detail::parse_qvalue(element.substr(semi + 1));
+    if (detail::is_equal_ci(coding, "gzip") ||
+      detail::is_equal_ci(coding, "x-gzip"))
+      gzip = qvalue;
+    else if (detail::is_equal_ci(coding, "deflate"))
+      deflate = qvalue;
+    else if (coding == "*")
+      any = qvalue;
+  }
+
+  if (gzip < 0)
+    gzip = std::max(any, 0);
+  if (deflate < 0)
+    deflate = std::max(any, 0);
+
+  if (gzip > 0 && gzip >= deflate)
+    return Content_coding::gzip;
+  else if (deflate > 0)
+    return Content_coding::deflate;
+  else
+    return Content_coding::identity;
+}
+
+} // namespace dmitigr::fcgi
+
+#ifdef DMITIGR_FCGI_ZLIB
+
+namespace dmitigr::fcgi::detail {
+
+/// The reusable state of the zlib compressor.
+class Deflater final {
+public:
+  /// The destructor.
+  ~Deflater()
+  {
+    if (is_initialized_)
+      deflateEnd(&stream_);
+  }
+
+  /// The default constructor.
+  Deflater() = default;
+
+  Deflater(const Deflater&) = delete;
+  Deflater& operator=(const Deflater&) = delete;
+  Deflater(Deflater&&) = delete;
+  Deflater& operator=(Deflater&&) = delete;
+
+  /// @returns The instance of the current thread.
+  static Deflater& thread_instance()
+  {
+    thread_local Deflater instance;
+    return instance;
+  }
+
+  /**
+   * @returns The compressor ready to compress a new stream.
+   *
+   * @par Requires
+   * `!is_busy()`.
+   */
+  z_stream& acquire(const Content_coding coding, const int level)
+  {
+    DMITIGR_ASSERT(!is_busy_);
+    DMITIGR_ASSERT(coding != Content_coding::identity);
+    const int window_bits = coding == Content_coding::gzip ? 15 + 16 : 15;
+    if (is_initialized_ && (window_bits_ != window_bits || level_ != level)) {
+      deflateEnd(&stream_);
+      is_initialized_ = false;
+    }
+
+    if (!is_initialized_) {
+      stream_ = {};
+      if (deflateInit2(&stream_, level, Z_DEFLATED, window_bits, 8,
+          Z_DEFAULT_STRATEGY) != Z_OK)
+        throw Exception{"cannot initialize zlib compressor"};
+      window_bits_ = window_bits;
+      level_ = level;
+      is_initialized_ = true;
+    } else if (deflateReset(&stream_) != Z_OK)
+      throw Exception{"cannot reset zlib compressor"};
+
+    is_busy_ = true;
+    return stream_;
+  }
+
+  /// Releases the compressor acquired by acquire().
+  void release() noexcept
+  {
+    is_busy_ = false;
+  }
+
+  /// @returns `true` if the compressor is acquired.
+  bool is_busy() const noexcept
+  {
+    return is_busy_;
+  }
+
+private:
+  bool is_initialized_{};
+  bool is_busy_{};
+  int window_bits_{};
+  int level_{};
+  z_stream stream_{};
+};
+
+/// The stream buffer of Compressed_ostream.
+class Deflate_streambuf final : public std::streambuf {
+public:
+  /// The destructor.
+  ~Deflate_streambuf() override
+  {
+    if (deflater_)
+      deflater_->release();
+  }
+
+  /// The constructor.
+  Deflate_streambuf(std::ostream& out, const Content_coding coding,
+    const std::size_t threshold, const int level)
+    : out_{out}
+    , server_out_{dynamic_cast<server_Streambuf*>(out.rdbuf())}
+    , coding_{coding}
+    , threshold_{std::min(threshold, buffer_.size())}
+    , level_{level}
+  {
+    if (!(-1 <= level && level <= 9))
+      throw Exception{"invalid compression level"};
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+  }
+
+  Deflate_streambuf(const Deflate_streambuf&) = delete;
+  Deflate_streambuf& operator=(const Deflate_streambuf&) = delete;
+  Deflate_streambuf(Deflate_streambuf&&) = delete;
+  Deflate_streambuf& operator=(Deflate_streambuf&&) = delete;
+
+  /// @see Compressed_ostream::coding().
+  Content_coding coding() const noexcept
+  {
+    return coding_;
+  }
+
+  /// @see Compressed_ostream::is_compressing().
+  bool is_compressing() const noexcept
+  {
+    return deflater_;
+  }
+
+  /// @see Compressed_ostream::finish().
+  void finish()
+  {
+    if (is_finished_)
+      return;
+
+    if (!is_started_)
+      start();
+    consume(Z_FINISH);
+    if (deflater_) {
+      deflater_->release();
+      deflater_ = nullptr;
+      z_ = nullptr;
+    }
+    is_finished_ = true;
+    setp(nullptr, nullptr);
+  }
+
+protected:
+  int_type overflow(const int_type ch) override
+  {
+    if (is_finished_)
+      return traits_type::eof();
+
+    if (!is_started_)
+      start();
+    consume(Z_NO_FLUSH);
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  int sync() override
+  {
+    if (is_finished_)
+      return 0;
+
+    if (!is_started_)
+      start();
+    consume(Z_SYNC_FLUSH);
+    return out_.flush() ? 0 : -1;
+  }
+
+private:
+  bool is_started_{};
+  bool is_finished_{};
+  std::ostream& out_;
+  server_Streambuf* const server_out_{};
+  Content_coding coding_{};
+  std::size_t threshold_{};
+  int level_{};
+  Deflater* deflater_{};
+  std::unique_ptr<Deflater> own_deflater_; // if the thread instance is busy
+  z_stream* z_{}; // acquired from deflater_
+  std::array<char, Compressed_ostream::max_threshold> buffer_;
+  std::array<char, 16384> output_; // unused if the output is direct
+
+  /**
+   * @brief Decides whether to compress the body by the size of the put area,
+   * and completes the header block accordingly.
+   */
+  void start()
+  {
+    DMITIGR_ASSERT(!is_started_);
+    const auto size = static_cast<std::size_t>(pptr() - pbase());
+    if (coding_ != Content_coding::identity && size >= threshold_) {
+      auto* deflater = &Deflater::thread_instance();
+      if (deflater->is_busy()) {
+        if (!own_deflater_)
+          own_deflater_ = std::make_unique<Deflater>();
+        deflater = own_deflater_.get();
+      }
+      z_ = &deflater->acquire(coding_, level_);
+      deflater_ = deflater;
+      out_ << "Content-Encoding: " << to_literal(coding_) << "\r\n";
+    }
+    out_ << "Vary: Accept-Encoding\r\n\r\n";
+    is_started_ = true;
+  }
+
+  /// Consumes the put area by writing it to `out_` (compressed if needed).
+  void consume(const int flush)
+  {
+    DMITIGR_ASSERT(is_started_);
+    const auto size = static_cast<std::size_t>(pptr() - pbase());
+    if (deflater_)
+      deflate(pbase(), size, flush);
+    else
+      out_.write(pbase(), static_cast<std::streamsize>(size));
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+    if (!out_)
+      throw Exception{"cannot write compressed FastCGI output"};
+  }
+
+  /**
+   * @brief Compresses the `data` of the given `size` into the put area of
+   * `server_out_` if it's not null and its put area is not guarded (see
+   * Flush_policy), or into the `output_` otherwise.
+   */
+  void deflate(const char* const data, const std::size_t size, const int flush)
+  {
+    DMITIGR_ASSERT(deflater_);
+    DMITIGR_ASSERT(z_);
+    auto& z = *z_;
+    const bool is_direct = server_out_ && !server_out_->is_put_area_guarded();
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    z.avail_in = static_cast<uInt>(size);
+    while (true) {
+      char* output{};
+      std::size_t output_size{};
+      if (is_direct) {
+        if (!server_out_->pbase())
+          throw Exception{"cannot write compressed FastCGI output to closed stream"};
+        else if (server_out_->pptr() == server_out_->epptr())
+          send_server_put_area();
+        output = server_out_->pptr();
+        output_size = static_cast<std::size_t>(server_out_->epptr() - output);
+      } else {
+        output = output_.data();
+        output_size = output_.size();
+      }
+
+      z.next_out = reinterpret_cast<Bytef*>(output);
+      z.avail_out = static_cast<uInt>(output_size);
+      const int r = ::deflate(&z, flush);
+      DMITIGR_ASSERT(r != Z_STREAM_ERROR);
+      const auto produced = output_size - z.avail_out;
+      if (is_direct)
+        server_out_->pbump(static_cast<int>(produced));
+      else
+        out_.write(output, static_cast<std::streamsize>(produced));
+
+      if (z.avail_out)
+        break; // all the input is consumed and all the output is flushed
+    }
+    DMITIGR_ASSERT(!z.avail_in);
+  }
+
+  /**
+   * @brief Sends the full put area of `server_out_` without pushing it, as if
+   * the put area overflowed upon its last byte.
+   */
+  void send_server_put_area()
+  {
+    DMITIGR_ASSERT(server_out_ && server_out_->pptr() == server_out_->epptr());
+    server_out_->pbump(-1);
+    const auto ch = traits_type::to_int_type(*server_out_->pptr());
+    if (traits_type::eq_int_type(server_out_->overflow(ch), traits_type::eof()))
+      throw Exception{"cannot write compressed FastCGI output"};
+  }
+};
+
+} // namespace dmitigr::fcgi::detail
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Compressed_ostream::~Compressed_ostream()
+{
+  try {
+    finish();
+  } catch (const std::exception& e) {
+    std::clog << "error upon finishing compressed stream: " << e.what() << "\n";
+  } catch (...) {
+    std::clog << "unknown error upon finishing compressed stream\n";
+  }
+}
+
+DMITIGR_FCGI_INLINE Compressed_ostream::Compressed_ostream(std::ostream& out,
+  const Content_coding coding, const std::size_t threshold, const int level)
+  : std::ostream{nullptr}
+  , streambuf_{std::make_unique<detail::Deflate_streambuf>(out, coding,
+      threshold, level)}
+{
+  rdbuf(streambuf_.get());
+}
+
+DMITIGR_FCGI_INLINE Compressed_ostream::Compressed_ostream(
+  Server_connection& connection, const std::size_t threshold, const int level)
+  : Compressed_ostream{connection.out(),
+      [&connection]
+      {
+        const auto index = connection.parameter_index("HTTP_ACCEPT_ENCODING");
+        return index ? negotiate_content_coding(connection.parameter(*index)) :
+          Content_coding::identity;
+      }(), threshold, level}
+{}
+
+DMITIGR_FCGI_INLINE Content_coding Compressed_ostream::coding() const noexcept
+{
+  return streambuf_->coding();
+}
+
+DMITIGR_FCGI_INLINE bool Compressed_ostream::is_compressing() const noexcept
+{
+  return streambuf_->is_compressing();
+}
+
+DMITIGR_FCGI_INLINE void Compressed_ostream::finish()
+{
+  streambuf_->finish();
+}
+
+} // namespace dmitigr::fcgi
+
+#endif  // DMITIGR_FCGI_ZLIB
@@ -0,0 +1,142 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_COMPRESSION_HPP
+#define DMITIGR_FCGI_COMPRESSION_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+namespace dmitigr::fcgi {
+
+/// A content coding of HTTP.
+enum class Content_coding {
+  /// No coding.
+  identity,
+
+  /// The gzip format (RFC 1952).
+  gzip,
+
+  /// The zlib format (RFC 1950).
+  deflate
+};
+
+/**
+ * @returns The literal of the `coding` suitable for `Content-Encoding`
+ * header of HTTP response.
+ */
+DMITIGR_FCGI_API std::string_view to_literal(Content_coding coding) noexcept;
+
+/**
+ * @returns The most preferred content coding acceptable according to the
+ * value of `Accept-Encoding` header of HTTP request (which is passed as
+ * `HTTP_ACCEPT_ENCODING` parameter), taking quality values into account.
+ * The gzip is preferred over the deflate given the equal quality values.
+ */
+DMITIGR_FCGI_API Content_coding
+negotiate_content_coding(std::string_view accept_encoding) noexcept;
+
+#ifdef DMITIGR_FCGI_ZLIB
+
+/**
+ * @brief The output stream which compresses the response body.
+ *
+ * @details The stream is layered over the output stream of the response, to
+ * which the header block of the HTTP response must be written *without* the
+ * terminating empty line. The stream completes the header block itself once
+ * either the size of the body reaches the threshold, or upon flush or
+ * finish(). If the body is compressed, the header block is completed with
+ * `Content-Encoding` and `Vary` headers. Thus, small bodies are transmitted
+ * uncompressed.
+ *
+ * If the underlying stream is the output stream of Server_connection, the
+ * compressed output is written straight into the put area of its stream
+ * buffer. The compressor state is reused by the streams of the same thread.
+ *
+ * @remarks Requires the zlib (`DMITIGR_FCGI_ZLIB` must be defined).
+ */
+class Compressed_ostream final : public std::ostream {
+public:
+  /// The default value of the threshold.
+  static constexpr std::size_t default_threshold{1024};
+
+  /// The maximum value of the threshold.
+  static constexpr std::size_t max_threshold{16384};
+
+  /// The destructor. Calls finish().
+  DMITIGR_FCGI_API ~Compressed_ostream() override;
+
+  /**
+   * @brief The constructor.
+   *
+   * @param out The output stream of the response.
+   * @param coding The content coding.
+   * @param threshold The minimum size of the body to compress. The values
+   * greater than `max_threshold` are treated as `max_threshold`.
+   * @param level The compression level in range [-1, 9], where `-1` denotes
+   * the default one.
+   */
+  DMITIGR_FCGI_API Compressed_ostream(std::ostream& out, Content_coding coding,
+    std::size_t threshold = default_threshold, int level = -1);
+
+  /**
+   * @overload
+   *
+   * @details The content coding is negotiated according to the parameter
+   * `HTTP_ACCEPT_ENCODING` of the `connection`, and the body is written to
+   * `connection.out()`.
+   */
+  DMITIGR_FCGI_API explicit Compressed_ostream(Server_connection& connection,
+    std::size_t threshold = default_threshold, int level = -1);
+
+  /// @returns The content coding.
+  DMITIGR_FCGI_API Content_coding coding() const noexcept;
+
+  /**
+   * @returns `true` if the body is being compressed. (Makes sense only after
+   * the header block is completed.)
+   */
+  DMITIGR_FCGI_API bool is_compressing() const noexcept;
+
+  /**
+   * @brief Completes the body.
+   *
+   * @details Completes the header block if not yet, and writes the rest of
+   * compressed data to the underlying stream.
+   *
+   * @par Effects
+   * The stream is unusable.
+   */
+  DMITIGR_FCGI_API void finish();
+
+private:
+  std::unique_ptr<detail::Deflate_streambuf> streambuf_;
+};
+
+#endif  // DMITIGR_FCGI_ZLIB
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "compression.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_COMPRESSION_HPP
@@ -17,13 +17,28 @@
 #ifndef DMITIGR_FCGI_FCGI_HPP
 #define DMITIGR_FCGI_FCGI_HPP
 
+#include "authorizer_cache.hpp"
 #include "basics.hpp"
+#include "body_spool.hpp"
+#include "client.hpp"
+#include "compression.hpp"
 #include "connection.hpp"
+#include "exceptions.hpp"
+#include "flush_policy.hpp"
+#include "form_fields.hpp"
+#include "gateway.hpp"
 #include "listener.hpp"
 #include "listener_options.hpp"
+#include "multipart.hpp"
+#include "prepared_response.hpp"
+#include "record_encoder.hpp"
+#include "record_parser.hpp"
+#include "response_cache.hpp"
+#include "response_headers.hpp"
 #include "server_connection.hpp"
 #include "streambuf.hpp"
 #include "streams.hpp"
 #include "version.hpp"
+#include "writer.hpp"
 
 #endif  // DMITIGR_FCGI_FCGI_HPP
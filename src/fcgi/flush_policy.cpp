@@ -0,0 +1,91 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exceptions.hpp"
+#include "flush_policy.hpp"
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Flush_policy&
+Flush_policy::set_byte_threshold(const std::optional<std::size_t> value)
+{
+  byte_threshold_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::size_t>
+Flush_policy::byte_threshold() const noexcept
+{
+  return byte_threshold_;
+}
+
+DMITIGR_FCGI_INLINE Flush_policy&
+Flush_policy::set_time_threshold(const std::optional<std::chrono::milliseconds> value)
+{
+  if (value && value->count() <= 0)
+    throw Exception{"invalid time threshold of flush policy"};
+  time_threshold_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::chrono::milliseconds>
+Flush_policy::time_threshold() const noexcept
+{
+  return time_threshold_;
+}
+
+DMITIGR_FCGI_INLINE Flush_policy&
+Flush_policy::set_flush_after_headers(const bool value)
+{
+  is_flush_after_headers_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE bool Flush_policy::is_flush_after_headers() const noexcept
+{
+  return is_flush_after_headers_;
+}
+
+DMITIGR_FCGI_INLINE Flush_policy&
+Flush_policy::set_coalescing_limit(const std::optional<std::size_t> value)
+{
+  coalescing_limit_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::size_t>
+Flush_policy::coalescing_limit() const noexcept
+{
+  return coalescing_limit_;
+}
+
+DMITIGR_FCGI_INLINE Flush_policy&
+Flush_policy::set_coalescing_interval(
+  const std::optional<std::chrono::milliseconds> value)
+{
+  if (value && value->count() <= 0)
+    throw Exception{"invalid coalescing interval of flush policy"};
+  coalescing_interval_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::chrono::milliseconds>
+Flush_policy::coalescing_interval() const noexcept
+{
+  return coalescing_interval_;
+}
+
+} // namespace dmitigr::fcgi
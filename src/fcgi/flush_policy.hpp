@@ -0,0 +1,151 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_FLUSH_POLICY_HPP
+#define DMITIGR_FCGI_FLUSH_POLICY_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief A policy of automatic flushing of the output streams.
+ *
+ * @details By default, the output is transmitted only when the buffer of the
+ * stream is full, or upon explicit flush, or upon closing the stream.
+ */
+class Flush_policy final {
+public:
+  /**
+   * @brief Sets the size of the pending output upon reaching which the output
+   * is flushed.
+   *
+   * @details The value of `std::nullopt` means the size of the stream buffer.
+   * The actual threshold is rounded up to the multiple of 8 (to avoid the
+   * padding of records) and limited by the size of the stream buffer.
+   *
+   * @par Effects
+   * `byte_threshold() == value`.
+   */
+  DMITIGR_FCGI_API Flush_policy& set_byte_threshold(std::optional<std::size_t> value);
+
+  /// @returns The size of the pending output upon reaching which it's flushed.
+  DMITIGR_FCGI_API std::optional<std::size_t> byte_threshold() const noexcept;
+
+  /**
+   * @brief Sets the maximum time the output can be pending before it's
+   * flushed.
+   *
+   * @details The value of `std::nullopt` means no limit. The time threshold
+   * is enforced by the timer of the Listener which has accepted the
+   * connection.
+   *
+   * @remarks Since the timer can flush the output concurrently with the
+   * handler, the writes to the stream are serialized with a mutex if the time
+   * threshold is set.
+   *
+   * @par Requires
+   * `!value || value->count() > 0`.
+   *
+   * @par Effects
+   * `time_threshold() == value`.
+   */
+  DMITIGR_FCGI_API Flush_policy&
+  set_time_threshold(std::optional<std::chrono::milliseconds> value);
+
+  /// @returns The maximum time the output can be pending before it's flushed.
+  DMITIGR_FCGI_API std::optional<std::chrono::milliseconds>
+  time_threshold() const noexcept;
+
+  /**
+   * @brief Sets the indicator to flush the output right after the header
+   * block of HTTP response (i.e. after the first `CRLFCRLF`).
+   *
+   * @par Effects
+   * `is_flush_after_headers() == value`.
+   */
+  DMITIGR_FCGI_API Flush_policy& set_flush_after_headers(bool value);
+
+  /// @returns `true` if the output is flushed after the header block.
+  DMITIGR_FCGI_API bool is_flush_after_headers() const noexcept;
+
+  /**
+   * @brief Sets the maximum size of the records produced by the explicit
+   * flushes to hold in the buffer of the stream before they are sent.
+   *
+   * @details If the value is not `std::nullopt`, an explicit flush completes
+   * the record but doesn't send it. Instead, the records produced by the
+   * consecutive flushes are sent together by a single write upon reaching the
+   * limit, or upon expiration of the coalescing interval, or upon the buffer
+   * overflow, or upon closing the stream. Thus, the number of records is the
+   * same, but the number of system calls and segments is reduced. The limit
+   * is restricted by the half of the size of the stream buffer.
+   *
+   * @par Effects
+   * `coalescing_limit() == value`.
+   *
+   * @see set_coalescing_interval().
+   */
+  DMITIGR_FCGI_API Flush_policy&
+  set_coalescing_limit(std::optional<std::size_t> value);
+
+  /// @returns The maximum size of the records to hold before sending.
+  DMITIGR_FCGI_API std::optional<std::size_t> coalescing_limit() const noexcept;
+
+  /**
+   * @brief Sets the maximum time the records produced by the explicit flushes
+   * can be held before they are sent.
+   *
+   * @details The value of `std::nullopt` means no limit. The interval is
+   * enforced by the timer of the Listener which has accepted the connection.
+   *
+   * @remarks Has effect only if the coalescing limit is set.
+   *
+   * @par Requires
+   * `!value || value->count() > 0`.
+   *
+   * @par Effects
+   * `coalescing_interval() == value`.
+   *
+   * @see set_coalescing_limit().
+   */
+  DMITIGR_FCGI_API Flush_policy&
+  set_coalescing_interval(std::optional<std::chrono::milliseconds> value);
+
+  /// @returns The maximum time the records can be held before sending.
+  DMITIGR_FCGI_API std::optional<std::chrono::milliseconds>
+  coalescing_interval() const noexcept;
+
+private:
+  std::optional<std::size_t> byte_threshold_;
+  std::optional<std::chrono::milliseconds> time_threshold_;
+  bool is_flush_after_headers_{};
+  std::optional<std::size_t> coalescing_limit_;
+  std::optional<std::chrono::milliseconds> coalescing_interval_;
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "flush_policy.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_FLUSH_POLICY_HPP
@@ -0,0 +1,204 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exceptions.hpp"
+#include "form_fields.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace dmitigr::fcgi::detail {
+
+/**
+ * @returns `true` if `data` of the given `size` contains either `%` or `+`.
+ *
+ * @details Eight bytes are tested at once (SWAR).
+ */
+inline bool is_url_escaped(const char* data, std::size_t size) noexcept
+{
+  constexpr std::uint64_t ones{0x0101010101010101};
+  constexpr std::uint64_t highs{0x8080808080808080};
+  constexpr std::uint64_t percents{ones * '%'};
+  constexpr std::uint64_t pluses{ones * '+'};
+  const auto has_zero_byte = [](const std::uint64_t w) noexcept
+  {
+    return (w - ones) & ~w & highs;
+  };
+
+  for (; size >= sizeof(std::uint64_t);
+       data += sizeof(std::uint64_t), size -= sizeof(std::uint64_t)) {
+    std::uint64_t w;
+    std::memcpy(&w, data, sizeof(w));
+    if (has_zero_byte(w ^ percents) | has_zero_byte(w ^ pluses))
+      return true;
+  }
+  for (; size; ++data, --size) {
+    if (*data == '%' || *data == '+')
+      return true;
+  }
+  return false;
+}
+
+/// @returns The value of the hex digit `c`, or `-1` if `c` is not a hex digit.
+inline int hex_digit_value(const char c) noexcept
+{
+  if ('0' <= c && c <= '9')
+    return c - '0';
+  else if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  else if ('A' <= c && c <= 'F')
+    return c - 'A' + 10;
+  else
+    return -1;
+}
+
+/**
+ * @brief Percent-decodes `str` into `result`. The invalid escapes are copied
+ * as is.
+ *
+ * @returns The pointer past the last decoded character.
+ */
+inline char* url_decode(const std::string_view str, char* result) noexcept
+{
+  for (std::size_t i{}; i < str.size(); ++i) {
+    const char c = str[i];
+    if (c == '+')
+      *result++ = ' ';
+    else if (c == '%' && i + 2 < str.size()) {
+      const int hi = hex_digit_value(str[i + 1]);
+      const int lo = hex_digit_value(str[i + 2]);
+      if (hi >= 0 && lo >= 0) {
+        *result++ = static_cast<char>(hi << 4 | lo);
+        i += 2;
+      } else
+        *result++ = c;
+    } else
+      *result++ = c;
+  }
+  return result;
+}
+
+} // namespace dmitigr::fcgi::detail
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Form_fields::Form_fields(const std::string_view data)
+{
+  char* decoded{};
+  const auto decode = [&decoded, this, &data](const std::string_view str)
+  {
+    if (!detail::is_url_escaped(str.data(), str.size()))
+      return str;
+
+    // The decoded data is never longer than the source.
+    if (!decoded_) {
+      decoded_ = std::make_unique<char[]>(data.size());
+      decoded = decoded_.get();
+    }
+    auto* const begin = decoded;
+    decoded = detail::url_decode(str, decoded);
+    return std::string_view{begin, static_cast<std::size_t>(decoded - begin)};
+  };
+
+  const char* p{data.data()};
+  const char* const end{data.data() + data.size()};
+  while (p != end) {
+    const auto* amp = static_cast<const char*>(std::memchr(p, '&',
+      static_cast<std::size_t>(end - p)));
+    if (!amp)
+      amp = end;
+
+    if (amp != p) {
+      const std::string_view pair{p, static_cast<std::size_t>(amp - p)};
+      const auto equal = pair.find('=');
+      append({decode(pair.substr(0, equal)), equal != std::string_view::npos ?
+        decode(pair.substr(equal + 1)) : std::string_view{}});
+    }
+    p = amp != end ? amp + 1 : end;
+  }
+}
+
+DMITIGR_FCGI_INLINE std::size_t Form_fields::field_count() const noexcept
+{
+  return size_;
+}
+
+DMITIGR_FCGI_INLINE bool Form_fields::is_empty() const noexcept
+{
+  return !size_;
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::size_t>
+Form_fields::field_index(const std::string_view name,
+  const std::size_t offset) const noexcept
+{
+  if (offset < size_) {
+    const auto b = begin();
+    const auto e = end();
+    const auto i = std::find_if(b + offset, e,
+      [name](const auto& field){return field.name == name;});
+    if (i != e)
+      return static_cast<std::size_t>(i - b);
+  }
+  return std::nullopt;
+}
+
+DMITIGR_FCGI_INLINE const Form_field&
+Form_fields::field(const std::size_t index) const
+{
+  if (!(index < field_count()))
+    throw Exception{"cannot get form field by using invalid index"};
+  return data()[index];
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::string_view>
+Form_fields::value(const std::string_view name) const noexcept
+{
+  if (const auto index = field_index(name))
+    return data()[*index].value;
+  else
+    return std::nullopt;
+}
+
+DMITIGR_FCGI_INLINE const Form_field* Form_fields::begin() const noexcept
+{
+  return data();
+}
+
+DMITIGR_FCGI_INLINE const Form_field* Form_fields::end() const noexcept
+{
+  return data() + size_;
+}
+
+DMITIGR_FCGI_INLINE const Form_field* Form_fields::data() const noexcept
+{
+  return size_ > inline_capacity ? fields_.data() : inline_fields_.data();
+}
+
+DMITIGR_FCGI_INLINE void Form_fields::append(const Form_field field)
+{
+  if (size_ < inline_capacity)
+    inline_fields_[size_] = field;
+  else {
+    if (size_ == inline_capacity)
+      fields_.assign(inline_fields_.cbegin(), inline_fields_.cend());
+    fields_.push_back(field);
+  }
+  ++size_;
+}
+
+} // namespace dmitigr::fcgi
@@ -0,0 +1,128 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_FORM_FIELDS_HPP
+#define DMITIGR_FCGI_FORM_FIELDS_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace dmitigr::fcgi {
+
+/// A field of Form_fields.
+struct Form_field final {
+  /// The decoded name.
+  std::string_view name;
+
+  /// The decoded value.
+  std::string_view value;
+};
+
+/**
+ * @brief The decoded fields of the query string (`QUERY_STRING` parameter) or
+ * of the `application/x-www-form-urlencoded` body.
+ *
+ * @details The fields are kept in the order of appearance, and the repeated
+ * names are preserved (i.e. this is a flat multimap). The names and values
+ * which contain no escapes (`%XX` or `+`) are the views of the source data,
+ * and only the rest are percent-decoded into the storage of the instance.
+ * The storage of the fields is allocated on the heap only if the number of
+ * fields exceeds `inline_capacity`.
+ *
+ * @remarks The source data (for example, the value of the parameter of the
+ * connection) must outlive the instance.
+ */
+class Form_fields final {
+public:
+  /// The number of fields stored without the heap allocation.
+  static constexpr std::size_t inline_capacity{16};
+
+  /// Constructs the empty instance.
+  Form_fields() = default;
+
+  /// Decodes the `data`.
+  DMITIGR_FCGI_API explicit Form_fields(std::string_view data);
+
+  /// Non copy-constructible.
+  Form_fields(const Form_fields&) = delete;
+
+  /// Non copy-assignable.
+  Form_fields& operator=(const Form_fields&) = delete;
+
+  /// Move-constructible.
+  Form_fields(Form_fields&&) = default;
+
+  /// Move-assignable.
+  Form_fields& operator=(Form_fields&&) = default;
+
+  /// @returns The number of fields.
+  DMITIGR_FCGI_API std::size_t field_count() const noexcept;
+
+  /// @returns `(field_count() == 0)`.
+  DMITIGR_FCGI_API bool is_empty() const noexcept;
+
+  /**
+   * @returns The index of the field by the `name` starting from `offset`,
+   * or `std::nullopt` if there is no such a field.
+   */
+  DMITIGR_FCGI_API std::optional<std::size_t>
+  field_index(std::string_view name, std::size_t offset = 0) const noexcept;
+
+  /**
+   * @returns The field by `index`.
+   *
+   * @par Requires
+   * `index < field_count()`.
+   */
+  DMITIGR_FCGI_API const Form_field& field(std::size_t index) const;
+
+  /**
+   * @returns The value of the first field by `name`, or `std::nullopt` if
+   * there is no such a field.
+   */
+  DMITIGR_FCGI_API std::optional<std::string_view>
+  value(std::string_view name) const noexcept;
+
+  /// @returns The iterator to the first field.
+  DMITIGR_FCGI_API const Form_field* begin() const noexcept;
+
+  /// @returns The iterator past the last field.
+  DMITIGR_FCGI_API const Form_field* end() const noexcept;
+
+private:
+  std::size_t size_{};
+  std::array<Form_field, inline_capacity> inline_fields_;
+  std::vector<Form_field> fields_; // used if size_ > inline_capacity
+  std::unique_ptr<char[]> decoded_; // the storage of decoded data
+
+  const Form_field* data() const noexcept;
+  void append(Form_field field);
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "form_fields.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_FORM_FIELDS_HPP
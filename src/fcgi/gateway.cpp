@@ -0,0 +1,291 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../base/assert.hpp"
+#include "../net/descriptor.hpp"
+#include "basics.hpp"
+#include "client.hpp"
+#include "exceptions.hpp"
+#include "gateway.hpp"
+#include "record_encoder.hpp"
+#include "server_connection.hpp"
+#include "streams.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+namespace dmitigr::fcgi {
+
+/// A backend of Gateway.
+struct Gateway::Backend final {
+  /// The constructor.
+  explicit Backend(net::Client_options options)
+    : options{std::move(options)}
+  {}
+
+  /// The options of the connections.
+  net::Client_options options;
+
+  /// The idle connections.
+  std::vector<std::shared_ptr<detail::Client_connection>> idle_connections;
+
+  /// The number of requests in progress.
+  std::size_t outstanding_request_count{};
+};
+
+DMITIGR_FCGI_INLINE Gateway::~Gateway() = default;
+
+DMITIGR_FCGI_INLINE Gateway::Gateway(std::vector<net::Client_options> backends,
+  const std::size_t max_connection_count)
+  : max_connection_count_{max_connection_count}
+{
+  if (backends.empty())
+    throw Exception{"no FastCGI gateway backends specified"};
+  else if (!max_connection_count)
+    throw Exception{"invalid maximum number of FastCGI gateway connections"};
+
+  backends_.reserve(backends.size());
+  for (auto& options : backends)
+    backends_.push_back(std::make_unique<Backend>(std::move(options)));
+}
+
+DMITIGR_FCGI_INLINE std::size_t Gateway::backend_count() const noexcept
+{
+  return backends_.size();
+}
+
+DMITIGR_FCGI_INLINE const net::Client_options&
+Gateway::backend(const std::size_t index) const
+{
+  if (!(index < backends_.size()))
+    throw Exception{"cannot get FastCGI gateway backend by using invalid index"};
+  return backends_[index]->options;
+}
+
+DMITIGR_FCGI_INLINE std::size_t
+Gateway::outstanding_request_count(const std::size_t index) const
+{
+  if (!(index < backends_.size()))
+    throw Exception{"cannot get FastCGI gateway backend by using invalid index"};
+  const std::lock_guard lg{mutex_};
+  return backends_[index]->outstanding_request_count;
+}
+
+DMITIGR_FCGI_INLINE void Gateway::forward(Server_connection& conn)
+{
+  if (conn.is_closed())
+    throw Exception{"cannot forward request of closed FastCGI connection"};
+  else if (conn.role() == Role::filter)
+    throw Exception{"FastCGI gateway doesn't support Filter role"};
+
+  auto& front = dynamic_cast<detail::iServer_connection&>(conn);
+  auto& in = front.in();
+  const int front_request_id = front.request_id();
+  constexpr int request_id{1};
+
+  // Encoding the begin-request record and the parameters.
+  std::string params;
+  {
+    const auto& parameters = front.parameters();
+    for (std::size_t i{}; i < parameters.pair_count(); ++i) {
+      const auto& pair = parameters.pair(i);
+      detail::append_name_value(params, pair.name(), pair.value());
+    }
+  }
+  Record_encoder message;
+  message.append_begin_request(request_id, front.role(), true)
+    .append_stream(Stream_type::params, request_id, params)
+    .append_end_of_stream(Stream_type::params, request_id);
+
+  /*
+   * Reading the input stream by the chunks of the maximum content length of
+   * the record. (The short chunk is the last one.) If the input stream fits
+   * into a single chunk, the request is encoded as a whole and can be retried.
+   */
+  std::string input(Record_encoder::max_content_length, '\0');
+  const auto append_input_chunk = [&in, &input](Record_encoder& encoder)
+  {
+    in.read(input.data(), static_cast<std::streamsize>(input.size()));
+    const auto size = static_cast<std::size_t>(in.gcount());
+    encoder.append_stream(Stream_type::in, request_id, {input.data(), size});
+    const bool is_end{size < input.size()};
+    if (is_end)
+      encoder.append_end_of_stream(Stream_type::in, request_id);
+    return is_end;
+  };
+  const bool is_input_encoded = append_input_chunk(message);
+
+  // The aborted request is not forwarded at all.
+  if (front.is_aborted())
+    return;
+
+  std::string record; // relayed
+  bool is_handed_over{};
+  while (true) {
+    std::size_t index{};
+    bool is_reused{};
+    auto connection = acquire(index, is_input_encoded, is_reused);
+    bool is_started{};
+    try {
+      auto& io = connection->io();
+
+      // Sending the request.
+      connection->write(message);
+      if (!is_input_encoded) {
+        Record_encoder input_record;
+        for (bool is_end{}; !is_end;) {
+          input_record.clear();
+          is_end = append_input_chunk(input_record);
+          net::write_all(io, input_record.iovecs(), input_record.iovec_count());
+        }
+      }
+
+      // Relaying the response. (The output streams are handed over at first.)
+      if (!is_handed_over) {
+        for (auto* const stream : {&front.err(), &front.out()}) {
+          if (!stream->is_closed())
+            static_cast<detail::server_Streambuf&>(
+              stream->streambuf()).hand_over();
+        }
+        is_handed_over = true;
+      }
+      bool is_abort_sent{};
+      while (true) {
+        // Propagating the abort of the request to the backend.
+        if (!is_abort_sent && front.poll_abort()) {
+          Record_encoder abort;
+          abort.append_abort_request(request_id);
+          net::write_all(io, abort.iovecs(), abort.iovec_count());
+          is_abort_sent = true;
+        }
+
+        detail::Header header;
+        detail::read_exactly(io, reinterpret_cast<char*>(&header),
+          sizeof(header));
+        header.check_validity();
+        is_started = true;
+        const auto type = header.record_type();
+        const std::size_t content_length = header.content_length();
+        const std::size_t padding_length = header.padding_length();
+        const auto size = content_length + padding_length;
+        if (header.request_id() != request_id) {
+          detail::skip_exactly(io, size);
+          continue;
+        }
+
+        if ((type == detail::Record_type::out ||
+          type == detail::Record_type::err) && !is_abort_sent) {
+          const detail::Header patched{type, front_request_id, content_length,
+            padding_length};
+          if (content_length >= splice_threshold)
+            front.write_relayed(reinterpret_cast<const char*>(&patched),
+              sizeof(patched), io, size);
+          else {
+            record.resize(sizeof(patched) + size);
+            std::memcpy(record.data(), &patched, sizeof(patched));
+            detail::read_exactly(io, record.data() + sizeof(patched), size);
+            front.write(record.data(), record.size());
+          }
+        } else if (type == detail::Record_type::end_request &&
+          content_length == sizeof(detail::End_request_body)) {
+          detail::End_request_body body;
+          detail::read_exactly(io, reinterpret_cast<char*>(&body),
+            sizeof(body));
+          detail::skip_exactly(io, padding_length);
+          const detail::End_request_record end{front_request_id,
+            body.application_status(), body.protocol_status()};
+          front.write(reinterpret_cast<const char*>(&end), sizeof(end));
+          break;
+        } else
+          detail::skip_exactly(io, size);
+      }
+    } catch (...) {
+      release(index, std::move(connection), true);
+      // The idle connection might be closed by the backend meanwhile.
+      if (is_reused && !is_started)
+        continue;
+      throw;
+    }
+    release(index, std::move(connection), false);
+    return;
+  }
+}
+
+DMITIGR_FCGI_INLINE std::shared_ptr<detail::Client_connection>
+Gateway::acquire(std::size_t& index, const bool is_reuse_allowed,
+  bool& is_reused)
+{
+  std::unique_lock lk{mutex_};
+  while (true) {
+    // Looking for the least loaded backend.
+    Backend* best{};
+    for (std::size_t i{}; i < backends_.size(); ++i) {
+      auto& backend = *backends_[i];
+      if (backend.outstanding_request_count < max_connection_count_ &&
+        (!best || backend.outstanding_request_count <
+          best->outstanding_request_count)) {
+        best = &backend;
+        index = i;
+      }
+    }
+    if (!best) {
+      connection_released_.wait(lk);
+      continue;
+    }
+
+    ++best->outstanding_request_count;
+    while (is_reuse_allowed && !best->idle_connections.empty()) {
+      auto result = std::move(best->idle_connections.back());
+      best->idle_connections.pop_back();
+      if (!result->is_stale()) {
+        is_reused = true;
+        return result;
+      }
+    }
+    is_reused = false;
+
+    lk.unlock();
+    try {
+      auto io = net::make_tcp_connection(best->options);
+      if (best->options.endpoint().communication_mode() ==
+        net::Communication_mode::net)
+        net::set_tcp_nodelay(static_cast<net::Socket_native>(
+            io->native_handle()), true);
+      return std::make_shared<detail::Client_connection>(std::move(io));
+    } catch (...) {
+      lk.lock();
+      --best->outstanding_request_count;
+      connection_released_.notify_all();
+      throw;
+    }
+  }
+}
+
+DMITIGR_FCGI_INLINE void Gateway::release(const std::size_t index,
+  std::shared_ptr<detail::Client_connection> connection, const bool is_broken)
+{
+  const std::lock_guard lg{mutex_};
+  auto& backend = *backends_[index];
+  DMITIGR_ASSERT(backend.outstanding_request_count);
+  --backend.outstanding_request_count;
+  if (!is_broken && !connection->is_stale())
+    backend.idle_connections.push_back(std::move(connection));
+  connection_released_.notify_all();
+}
+
+} // namespace dmitigr::fcgi
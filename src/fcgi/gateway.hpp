@@ -0,0 +1,137 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_GATEWAY_HPP
+#define DMITIGR_FCGI_GATEWAY_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+#include "../net/client.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief A gateway which forwards the requests to the pool of backends
+ * (FastCGI applications).
+ *
+ * @details The request is forwarded to the backend with the least number of
+ * outstanding requests. The parameters are encoded from the connection, and
+ * the input stream is forwarded by the records of the maximum size. The
+ * records of the output streams and the end-request record of the backend
+ * are relayed to the connection as is, except the request ID. (On Linux, the
+ * content of the large records is moved between the sockets by `splice()`,
+ * i.e. without copying it to the user space.) The connections to the backends
+ * are kept in the pool, each of them serves one request at a time. If the
+ * request failed on a reused connection before any response is received, it's
+ * repeated over another one provided the input stream fits into one record.
+ * The abort of the request (see Server_connection::poll_abort()) is
+ * propagated to the backend, and the rest of its output is discarded.
+ *
+ * @remarks The instance can be shared between threads.
+ */
+class Gateway final {
+public:
+  /**
+   * @brief The constructor.
+   *
+   * @param backends The options of the connections to the backends.
+   * @param max_connection_count The maximum number of connections to a
+   * backend.
+   *
+   * @par Requires
+   * `!backends.empty() && max_connection_count > 0`.
+   */
+  DMITIGR_FCGI_API explicit Gateway(std::vector<net::Client_options> backends,
+    std::size_t max_connection_count = 8);
+
+  /// The destructor.
+  DMITIGR_FCGI_API ~Gateway();
+
+  /// Non copy-constructible.
+  Gateway(const Gateway&) = delete;
+
+  /// Non copy-assignable.
+  Gateway& operator=(const Gateway&) = delete;
+
+  /// Non move-constructible.
+  Gateway(Gateway&&) = delete;
+
+  /// Non move-assignable.
+  Gateway& operator=(Gateway&&) = delete;
+
+  /// @returns The number of backends.
+  DMITIGR_FCGI_API std::size_t backend_count() const noexcept;
+
+  /**
+   * @returns The options of the connections to the backend.
+   *
+   * @par Requires
+   * `index < backend_count()`.
+   */
+  DMITIGR_FCGI_API const net::Client_options& backend(std::size_t index) const;
+
+  /**
+   * @returns The number of requests in progress on the backend.
+   *
+   * @par Requires
+   * `index < backend_count()`.
+   */
+  DMITIGR_FCGI_API std::size_t outstanding_request_count(std::size_t index) const;
+
+  /**
+   * @brief Forwards the request of `conn` to a backend and relays the
+   * response.
+   *
+   * @details Waits for a connection to a backend if all of them are busy.
+   * Upon return the output streams of `conn` are closed, and the application
+   * status of the backend is sent to the client.
+   *
+   * @par Requires
+   * `conn` is not closed, its role is not Role::filter, and its input stream
+   * is not read yet.
+   */
+  DMITIGR_FCGI_API void forward(Server_connection& conn);
+
+private:
+  struct Backend;
+
+  /// The minimum content length of a record to be relayed by `splice()`.
+  static constexpr std::size_t splice_threshold{4096};
+
+  std::vector<std::unique_ptr<Backend>> backends_;
+  std::size_t max_connection_count_{};
+  mutable std::mutex mutex_;
+  std::condition_variable connection_released_;
+
+  std::shared_ptr<detail::Client_connection> acquire(std::size_t& index,
+    bool is_reuse_allowed, bool& is_reused);
+  void release(std::size_t index,
+    std::shared_ptr<detail::Client_connection> connection, bool is_broken);
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "gateway.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_GATEWAY_HPP
@@ -21,11 +21,16 @@
 #include "listener.hpp"
 #include "server_connection_stacked.cpp"
 
+#include <sstream>
+#include <string>
+
 namespace dmitigr::fcgi {
 
 DMITIGR_FCGI_INLINE Listener::Listener(Listener_options options)
   : listener_{net::Listener::make(options.options_)}
   , listener_options_{std::move(options)}
+  , flush_timer_{std::make_shared<detail::Flush_timer>()}
+  , in_flight_request_count_{std::make_shared<std::atomic<std::size_t>>(0)}
 {}
 
 DMITIGR_FCGI_INLINE const Listener_options& Listener::options() const noexcept
@@ -50,16 +55,61 @@ DMITIGR_FCGI_INLINE bool Listener::wait(const std::chrono::milliseconds timeout)
 
 DMITIGR_FCGI_INLINE std::unique_ptr<Server_connection> Listener::accept()
 {
+  const auto is_socket = [this]
+  {
+#ifdef _WIN32
+    return listener_options_.endpoint().communication_mode() !=
+      net::Communication_mode::wnp;
+#else
+    return true;
+#endif
+  };
+
   auto io = listener_->accept();
+  if (listener_options_.endpoint().communication_mode() ==
+    net::Communication_mode::net) {
+    if (const auto nodelay = listener_options_.tcp_nodelay())
+      net::set_tcp_nodelay(static_cast<net::Socket_native>(io->native_handle()),
+        *nodelay);
+    io->set_output_policy(listener_options_.output_policy());
+    if (listener_options_.zerocopy_threshold())
+      io->enable_zerocopy();
+  }
   detail::Header header{io.get()};
 
+  // Answering the management records which precede the request.
+  while (header.is_management_record()) {
+    std::string content(header.content_length() + header.padding_length(),
+      '\0');
+    for (std::size_t offset{}; offset < content.size();) {
+      const auto count = io->read(content.data() + offset,
+        static_cast<std::streamsize>(content.size() - offset));
+      if (count <= 0)
+        throw Exception{"FastCGI protocol violation"};
+      offset += static_cast<std::size_t>(count);
+    }
+
+    if (header.record_type() == detail::Record_type::get_values) {
+      content.resize(header.content_length());
+      std::istringstream stream{std::move(content)};
+      const detail::Names_values variables{stream};
+      const auto record = detail::get_values_result(variables,
+        listener_options_.max_concurrent_request_count());
+      net::write_all(*io, record.data(),
+        static_cast<std::streamsize>(record.size()));
+    } else {
+      const detail::Unknown_type_record record{header.record_type()};
+      net::write_all(*io, reinterpret_cast<const char*>(&record),
+        sizeof(record));
+    }
+    header = detail::Header{io.get()};
+  }
+
   const auto end_request = [&](const detail::Protocol_status protocol_status)
   {
     const detail::End_request_record record{header.request_id(),
       0, protocol_status};
-    const auto count = io->write(reinterpret_cast<const char*>(&record),
-      sizeof(record));
-    DMITIGR_ASSERT(count == sizeof(record));
+    net::write_all(*io, reinterpret_cast<const char*>(&record), sizeof(record));
   };
 
   if (header.record_type() == detail::Record_type::begin_request &&
@@ -69,8 +119,25 @@ DMITIGR_FCGI_INLINE std::unique_ptr<Server_connection> Listener::accept()
     const auto role = body.role();
     if (role == Role::responder ||
       role == Role::authorizer || role == Role::filter) {
+      auto admission_ticket = detail::Admission_ticket::acquire(
+        in_flight_request_count_,
+        listener_options_.max_in_flight_request_count());
+      if (!admission_ticket) {
+        /*
+         * The client which keeps the connection would never end the data, so
+         * the rejected connection is closed without the lingering.
+         */
+        end_request(detail::Protocol_status::overloaded);
+        io->close_promptly();
+        return nullptr;
+      }
+
+      if (listener_options_.is_nonblocking() && is_socket())
+        net::set_nonblocking(static_cast<net::Socket_native>(
+          io->native_handle()), true);
       return std::make_unique<detail::stack_buffers_Server_connection>(
-        std::move(io), role, header.request_id(), body.is_keep_conn());
+        std::move(io), role, header.request_id(), body.is_keep_conn(),
+        listener_options_, flush_timer_, std::move(admission_ticket));
     } else {
       // This is a protocol violation.
       end_request(detail::Protocol_status::unknown_role);
@@ -92,4 +159,9 @@ DMITIGR_FCGI_INLINE void Listener::close()
   listener_->close();
 }
 
+DMITIGR_FCGI_INLINE std::size_t Listener::in_flight_request_count() const noexcept
+{
+  return *in_flight_request_count_;
+}
+
 } // namespace dmitigr::fcgi
@@ -21,7 +21,10 @@
 #include "listener_options.hpp"
 #include "types_fwd.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <memory>
 
 namespace dmitigr::fcgi {
 
@@ -63,10 +66,20 @@ public:
   wait(std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
 
   /**
-   * @brief Accepts a FastCGI connection, or rejects it in case of a
-   * protocol violation.
+   * @brief Accepts a FastCGI connection, or rejects it in case of either a
+   * protocol violation or the overload.
    *
-   * @returns An instance of the accepted FastCGI connection.
+   * @details The management records which precede the request are answered
+   * (see Listener_options::set_max_connection_count()). If the number of
+   * requests in progress has reached the limit, the request is rejected with
+   * the protocol status `FCGI_OVERLOADED` right after the begin-request
+   * record (see Listener_options::set_max_in_flight_request_count()). The
+   * connection of the rejected request is closed without waiting for the
+   * client to end it, so the rejection never blocks even if the client keeps
+   * the connection.
+   *
+   * @returns An instance of the accepted FastCGI connection, or `nullptr` if
+   * the request is rejected because of the overload.
    *
    * @par Requires
    * `is_listening()`.
@@ -80,9 +93,17 @@ public:
   /// Stops listening.
   DMITIGR_FCGI_API void close();
 
+  /**
+   * @returns The number of requests in progress, i.e. of the connections
+   * accepted by this listener and not yet destroyed.
+   */
+  DMITIGR_FCGI_API std::size_t in_flight_request_count() const noexcept;
+
 private:
   std::unique_ptr<net::Listener> listener_;
   Listener_options listener_options_;
+  std::shared_ptr<detail::Flush_timer> flush_timer_;
+  std::shared_ptr<std::atomic<std::size_t>> in_flight_request_count_;
 };
 
 } // namespace dmitigr::fcgi
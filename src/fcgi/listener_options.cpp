@@ -14,8 +14,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "exceptions.hpp"
 #include "listener_options.hpp"
 
+#include <algorithm>
+
 namespace dmitigr::fcgi {
 
 #ifdef _WIN32
@@ -44,4 +47,119 @@ DMITIGR_FCGI_INLINE std::optional<int> Listener_options::backlog() const noexcep
   return options_.backlog();
 }
 
+DMITIGR_FCGI_INLINE Listener_options&
+Listener_options::set_output_policy(const net::Output_policy value)
+{
+  output_policy_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE net::Output_policy
+Listener_options::output_policy() const noexcept
+{
+  return output_policy_;
+}
+
+DMITIGR_FCGI_INLINE Listener_options&
+Listener_options::set_tcp_nodelay(const std::optional<bool> value)
+{
+  tcp_nodelay_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::optional<bool>
+Listener_options::tcp_nodelay() const noexcept
+{
+  return tcp_nodelay_;
+}
+
+DMITIGR_FCGI_INLINE Listener_options&
+Listener_options::set_nonblocking(const bool value)
+{
+  is_nonblocking_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE bool Listener_options::is_nonblocking() const noexcept
+{
+  return is_nonblocking_;
+}
+
+DMITIGR_FCGI_INLINE Listener_options&
+Listener_options::set_output_backlog_limit(const std::size_t value)
+{
+  output_backlog_limit_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::size_t
+Listener_options::output_backlog_limit() const noexcept
+{
+  return output_backlog_limit_;
+}
+
+DMITIGR_FCGI_INLINE Listener_options&
+Listener_options::set_zerocopy_threshold(const std::optional<std::size_t> value)
+{
+  zerocopy_threshold_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::size_t>
+Listener_options::zerocopy_threshold() const noexcept
+{
+  return zerocopy_threshold_;
+}
+
+DMITIGR_FCGI_INLINE Listener_options&
+Listener_options::set_flush_policy(Flush_policy value)
+{
+  flush_policy_ = std::move(value);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE const Flush_policy&
+Listener_options::flush_policy() const noexcept
+{
+  return flush_policy_;
+}
+
+DMITIGR_FCGI_INLINE Listener_options&
+Listener_options::set_max_connection_count(const std::size_t value)
+{
+  if (!value)
+    throw Exception{"invalid maximum number of FastCGI connections"};
+  max_connection_count_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::size_t
+Listener_options::max_connection_count() const noexcept
+{
+  return max_connection_count_;
+}
+
+DMITIGR_FCGI_INLINE Listener_options&
+Listener_options::set_max_in_flight_request_count(
+  const std::optional<std::size_t> value)
+{
+  if (value && !*value)
+    throw Exception{"invalid maximum number of FastCGI requests in progress"};
+  max_in_flight_request_count_ = value;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::size_t>
+Listener_options::max_in_flight_request_count() const noexcept
+{
+  return max_in_flight_request_count_;
+}
+
+DMITIGR_FCGI_INLINE std::size_t
+Listener_options::max_concurrent_request_count() const noexcept
+{
+  return std::min(max_connection_count_,
+    max_in_flight_request_count_.value_or(max_connection_count_));
+}
+
 } // namespace dmitigr::fcgi
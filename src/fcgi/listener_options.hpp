@@ -20,8 +20,10 @@
 #include "../fs/filesystem.hpp"
 #include "../net/listener.hpp"
 #include "dll.hpp"
+#include "flush_policy.hpp"
 #include "types_fwd.hpp"
 
+#include <cstddef>
 #include <optional>
 #include <string>
 
@@ -83,10 +85,180 @@ public:
    */
   DMITIGR_FCGI_API std::optional<int> backlog() const noexcept;
 
+  /**
+   * @brief Sets the output policy of the accepted connections.
+   *
+   * @details The output policy controls how the records of a response are
+   * pushed to the network: with `net::Output_policy::msg_more` or
+   * `net::Output_policy::cork` the intermediate records are deferred until
+   * either the end of the request or an explicit flush of the stream.
+   *
+   * @remarks Has effect only if the communication mode of the endpoint is
+   * `Communication_mode::net`.
+   *
+   * @par Effects
+   * `output_policy() == value`.
+   */
+  DMITIGR_FCGI_API Listener_options& set_output_policy(net::Output_policy value);
+
+  /// @returns The output policy of the accepted connections.
+  DMITIGR_FCGI_API net::Output_policy output_policy() const noexcept;
+
+  /**
+   * @brief Sets the value of `TCP_NODELAY` option of the accepted connections.
+   *
+   * @details The value of `std::nullopt` means the system default.
+   *
+   * @remarks Has effect only if the communication mode of the endpoint is
+   * `Communication_mode::net`.
+   *
+   * @par Effects
+   * `tcp_nodelay() == value`.
+   */
+  DMITIGR_FCGI_API Listener_options& set_tcp_nodelay(std::optional<bool> value);
+
+  /// @returns The value of `TCP_NODELAY` option of the accepted connections.
+  DMITIGR_FCGI_API std::optional<bool> tcp_nodelay() const noexcept;
+
+  /**
+   * @brief Sets the non-blocking mode of the accepted connections.
+   *
+   * @details In the non-blocking mode the output which cannot be written
+   * immediately is queued into the per-connection output backlog. The
+   * backlog is drained upon the subsequent I/O of the connection only, and
+   * upon closing the connection, which blocks until the backlog is empty.
+   *
+   * @remarks Has no effect if the communication mode of the endpoint is
+   * `Communication_mode::wnp`.
+   *
+   * @par Effects
+   * `is_nonblocking() == value`.
+   *
+   * @see set_output_backlog_limit().
+   */
+  DMITIGR_FCGI_API Listener_options& set_nonblocking(bool value);
+
+  /// @returns `true` if the accepted connections are non-blocking.
+  DMITIGR_FCGI_API bool is_nonblocking() const noexcept;
+
+  /**
+   * @brief Sets the maximum size (in bytes) of the per-connection output
+   * backlog.
+   *
+   * @details Upon exceeding this limit, writes to the output streams block
+   * until the backlog is drained below the limit.
+   *
+   * @par Effects
+   * `output_backlog_limit() == value`.
+   *
+   * @see set_nonblocking().
+   */
+  DMITIGR_FCGI_API Listener_options& set_output_backlog_limit(std::size_t value);
+
+  /// @returns The maximum size of the per-connection output backlog.
+  DMITIGR_FCGI_API std::size_t output_backlog_limit() const noexcept;
+
+  /**
+   * @brief Sets the minimum size (in bytes) of the output records to be
+   * transmitted without copying the data into the kernel (`MSG_ZEROCOPY`).
+   *
+   * @details The value of `std::nullopt` disables the zero-copy transmission.
+   * Since each zero-copy transmission has a cost of the page pinning and of
+   * the completion notification, it pays off only for large records (at least
+   * 10 KiB or so) of large responses.
+   *
+   * @remarks Has effect only if the communication mode of the endpoint is
+   * `Communication_mode::net` and the zero-copy transmission is supported by
+   * the system.
+   *
+   * @par Effects
+   * `zerocopy_threshold() == value`.
+   */
+  DMITIGR_FCGI_API Listener_options&
+  set_zerocopy_threshold(std::optional<std::size_t> value);
+
+  /// @returns The minimum size of the output records transmitted with zero-copy.
+  DMITIGR_FCGI_API std::optional<std::size_t> zerocopy_threshold() const noexcept;
+
+  /**
+   * @brief Sets the policy of automatic flushing of the output streams of
+   * the accepted connections.
+   *
+   * @par Effects
+   * `flush_policy() == value`.
+   *
+   * @see Server_connection::set_flush_policy().
+   */
+  DMITIGR_FCGI_API Listener_options& set_flush_policy(Flush_policy value);
+
+  /// @returns The policy of automatic flushing of the output streams.
+  DMITIGR_FCGI_API const Flush_policy& flush_policy() const noexcept;
+
+  /**
+   * @brief Sets the maximum number of connections the application serves
+   * concurrently (for example, the number of threads which accept and serve
+   * the connections).
+   *
+   * @details This value limits the capacity reported to the client (see
+   * max_concurrent_request_count()).
+   *
+   * @par Requires
+   * `value > 0`.
+   *
+   * @par Effects
+   * `max_connection_count() == value`.
+   */
+  DMITIGR_FCGI_API Listener_options& set_max_connection_count(std::size_t value);
+
+  /// @returns The maximum number of connections served concurrently.
+  DMITIGR_FCGI_API std::size_t max_connection_count() const noexcept;
+
+  /**
+   * @brief Sets the maximum number of requests in progress, i.e. of the
+   * connections accepted by the listener and not yet destroyed.
+   *
+   * @details The value of `std::nullopt` means no limit. Once this limit is
+   * reached, the requests are rejected by Listener::accept() with the
+   * protocol status `FCGI_OVERLOADED` right after the begin-request record,
+   * i.e. without reading the parameters and without creating a connection.
+   *
+   * @par Requires
+   * `!value || *value > 0`.
+   *
+   * @par Effects
+   * `max_in_flight_request_count() == value`.
+   *
+   * @see Listener::in_flight_request_count().
+   */
+  DMITIGR_FCGI_API Listener_options&
+  set_max_in_flight_request_count(std::optional<std::size_t> value);
+
+  /// @returns The maximum number of requests in progress.
+  DMITIGR_FCGI_API std::optional<std::size_t>
+  max_in_flight_request_count() const noexcept;
+
+  /**
+   * @returns The maximum number of requests served concurrently, i.e. the
+   * minimum of max_connection_count() and max_in_flight_request_count().
+   *
+   * @details This value is reported to the client in reply to the
+   * get-values record as `FCGI_MAX_CONNS` and `FCGI_MAX_REQS`, since each
+   * connection serves one request at a time (`FCGI_MPXS_CONNS` is `0`).
+   */
+  DMITIGR_FCGI_API std::size_t max_concurrent_request_count() const noexcept;
+
 private:
   friend Listener;
 
   net::Listener_options options_;
+  net::Output_policy output_policy_{net::Output_policy::immediate};
+  std::optional<bool> tcp_nodelay_;
+  bool is_nonblocking_{};
+  std::size_t output_backlog_limit_{1048576};
+  std::optional<std::size_t> zerocopy_threshold_;
+  Flush_policy flush_policy_;
+  std::size_t max_connection_count_{1};
+  std::optional<std::size_t> max_in_flight_request_count_;
 };
 
 } // namespace dmitigr::fcgi
@@ -0,0 +1,365 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../base/assert.hpp"
+#include "exceptions.hpp"
+#include "multipart.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace dmitigr::fcgi::detail {
+
+/// @returns `true` if `a` and `b` are equal case-insensitively (ASCII only).
+inline bool is_iequal(const std::string_view a, const std::string_view b) noexcept
+{
+  const auto lower = [](const char c) noexcept
+  {
+    return ('A' <= c && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+  };
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+    [&lower](const char c1, const char c2){return lower(c1) == lower(c2);});
+}
+
+/// @returns The `str` without the leading and trailing spaces and tabs.
+inline std::string_view trimmed(std::string_view str) noexcept
+{
+  const auto is_space = [](const char c) noexcept
+  {
+    return c == ' ' || c == '\t';
+  };
+  while (!str.empty() && is_space(str.front()))
+    str.remove_prefix(1);
+  while (!str.empty() && is_space(str.back()))
+    str.remove_suffix(1);
+  return str;
+}
+
+/**
+ * @brief Calls `callback(name, value)` for each parameter of the header value
+ * like `type; name1=value1; name2="value2"`.
+ *
+ * @remarks The quoted values are returned without quotes and unescaped.
+ */
+template<typename F>
+void for_each_header_parameter(std::string_view value, F&& callback)
+{
+  while (true) {
+    const auto semicolon = value.find(';');
+    if (semicolon == std::string_view::npos)
+      return;
+    value.remove_prefix(semicolon + 1);
+
+    const auto equal = value.find('=');
+    if (equal == std::string_view::npos)
+      return;
+    const auto name = trimmed(value.substr(0, equal));
+    value = trimmed(value.substr(equal + 1));
+    std::string_view param;
+    if (!value.empty() && value.front() == '"') {
+      const auto quote = value.find('"', 1);
+      param = value.substr(1, quote == std::string_view::npos ?
+        std::string_view::npos : quote - 1);
+      value.remove_prefix(quote == std::string_view::npos ?
+        value.size() : quote + 1);
+    } else
+      param = trimmed(value.substr(0, value.find(';')));
+    callback(name, param);
+  }
+}
+
+} // namespace dmitigr::fcgi::detail
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE std::optional<std::string_view>
+multipart_boundary(const std::string_view content_type) noexcept
+{
+  constexpr std::string_view multipart{"multipart/"};
+  if (!detail::is_iequal(content_type.substr(0, multipart.size()), multipart))
+    return std::nullopt;
+
+  std::optional<std::string_view> result;
+  detail::for_each_header_parameter(content_type,
+    [&result](const std::string_view name, const std::string_view value)
+    {
+      if (!result && detail::is_iequal(name, "boundary") && !value.empty())
+        result = value;
+    });
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+// Multipart_part
+// -----------------------------------------------------------------------------
+
+DMITIGR_FCGI_INLINE std::size_t Multipart_part::header_count() const noexcept
+{
+  return headers_.size();
+}
+
+DMITIGR_FCGI_INLINE std::pair<std::string_view, std::string_view>
+Multipart_part::header(const std::size_t index) const
+{
+  if (!(index < header_count()))
+    throw Exception{"cannot get multipart header by using invalid index"};
+  return headers_[index];
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::string_view>
+Multipart_part::header(const std::string_view name) const noexcept
+{
+  const auto i = std::find_if(headers_.cbegin(), headers_.cend(),
+    [name](const auto& h){return detail::is_iequal(h.first, name);});
+  return i != headers_.cend() ? std::optional{i->second} : std::nullopt;
+}
+
+DMITIGR_FCGI_INLINE std::string_view Multipart_part::name() const noexcept
+{
+  return name_;
+}
+
+DMITIGR_FCGI_INLINE std::optional<std::string_view>
+Multipart_part::filename() const noexcept
+{
+  return filename_;
+}
+
+DMITIGR_FCGI_INLINE std::string_view Multipart_part::content_type() const noexcept
+{
+  return header("Content-Type").value_or("text/plain");
+}
+
+DMITIGR_FCGI_INLINE void Multipart_part::reset(std::string_view header_block)
+{
+  headers_.clear();
+  name_ = {};
+  filename_.reset();
+  while (!header_block.empty()) {
+    const auto eol = header_block.find("\r\n");
+    const auto line = header_block.substr(0, eol);
+    header_block.remove_prefix(eol == std::string_view::npos ?
+      header_block.size() : eol + 2);
+    if (const auto colon = line.find(':'); colon != std::string_view::npos)
+      headers_.emplace_back(detail::trimmed(line.substr(0, colon)),
+        detail::trimmed(line.substr(colon + 1)));
+  }
+
+  if (const auto disposition = header("Content-Disposition")) {
+    detail::for_each_header_parameter(*disposition,
+      [this](const std::string_view name, const std::string_view value)
+      {
+        if (detail::is_iequal(name, "name"))
+          name_ = value;
+        else if (detail::is_iequal(name, "filename"))
+          filename_ = value;
+      });
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Multipart_parser
+// -----------------------------------------------------------------------------
+
+DMITIGR_FCGI_INLINE Multipart_parser::Multipart_parser(
+  const std::string_view boundary)
+  : delimiter_{std::string{"\r\n--"}.append(boundary)}
+{
+  if (boundary.empty() || boundary.size() > 70)
+    throw Exception{"invalid multipart boundary"};
+}
+
+DMITIGR_FCGI_INLINE Multipart_parser&
+Multipart_parser::set_part_handler(Part_handler handler)
+{
+  part_handler_ = std::move(handler);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Multipart_parser&
+Multipart_parser::set_data_handler(Data_handler handler)
+{
+  data_handler_ = std::move(handler);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Multipart_parser&
+Multipart_parser::set_part_end_handler(Part_end_handler handler)
+{
+  part_end_handler_ = std::move(handler);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE void Multipart_parser::parse(const char* data,
+  std::size_t size)
+{
+  while (size) {
+    if (buffer_.empty()) {
+      // Usually, the input is consumed in place.
+      const auto consumed = consume(data, data + size);
+      buffer_.assign(data + consumed, size - consumed);
+      return;
+    }
+
+    /*
+     * Completing the unconsumed tail of the previous input. The tail is short
+     * (less than the delimiter) unless the header block is incomplete.
+     */
+    const auto length = state_ == State::headers ?
+      size : std::min(size, delimiter_.size());
+    buffer_.append(data, length);
+    data += length;
+    size -= length;
+    const auto consumed = consume(buffer_.data(),
+      buffer_.data() + buffer_.size());
+    buffer_.erase(0, consumed);
+  }
+}
+
+DMITIGR_FCGI_INLINE void Multipart_parser::parse(std::istream& in)
+{
+  std::array<char, 16384> chunk;
+  while (in) {
+    in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    parse(chunk.data(), static_cast<std::size_t>(in.gcount()));
+  }
+  if (in.bad())
+    throw Exception{"cannot read multipart body"};
+  else if (!is_done())
+    throw Exception{"incomplete multipart body"};
+}
+
+DMITIGR_FCGI_INLINE bool Multipart_parser::is_done() const noexcept
+{
+  return state_ == State::done;
+}
+
+DMITIGR_FCGI_INLINE std::size_t
+Multipart_parser::consume(const char* const begin, const char* const end)
+{
+  const std::string_view delimiter{delimiter_};
+  const char* p{begin};
+
+  /*
+   * @returns The position of the delimiter in [p, end), or the position of
+   * the incomplete delimiter at the end of the input, or `end`.
+   */
+  const auto find_delimiter = [&delimiter, &p, end]() noexcept
+  {
+    const char* c{p};
+    while (true) {
+      c = static_cast<const char*>(std::memchr(c, delimiter.front(),
+        static_cast<std::size_t>(end - c)));
+      if (!c)
+        return end;
+      else if (!std::memcmp(c, delimiter.data(),
+          std::min(static_cast<std::size_t>(end - c), delimiter.size())))
+        return c;
+      ++c;
+    }
+  };
+
+  while (p != end) {
+    switch (state_) {
+    case State::preamble: {
+      // The first delimiter may be at the beginning without leading CRLF.
+      if (is_body_begin_) {
+        const auto dash_boundary = delimiter.substr(2);
+        const auto length = std::min(static_cast<std::size_t>(end - p),
+          dash_boundary.size());
+        if (std::memcmp(p, dash_boundary.data(), length))
+          is_body_begin_ = false;
+        else if (length < dash_boundary.size())
+          return static_cast<std::size_t>(p - begin);
+        else {
+          is_body_begin_ = false;
+          p += length;
+          state_ = State::delimiter_end;
+          continue;
+        }
+      }
+
+      // Discarding the preamble.
+      const auto* const d = find_delimiter();
+      if (static_cast<std::size_t>(end - d) < delimiter.size())
+        return static_cast<std::size_t>(d - begin);
+      p = d + delimiter.size();
+      state_ = State::delimiter_end;
+      continue;
+    }
+
+    case State::delimiter_end:
+      // Skipping the transport padding.
+      while (p != end && (*p == ' ' || *p == '\t'))
+        ++p;
+      if (end - p < 2)
+        return static_cast<std::size_t>(p - begin);
+      else if (p[0] == '-' && p[1] == '-')
+        state_ = State::done;
+      else if (p[0] == '\r' && p[1] == '\n')
+        state_ = State::headers;
+      else
+        throw Exception{"invalid multipart delimiter"};
+      p += 2;
+      continue;
+
+    case State::headers: {
+      const std::string_view rest{p, static_cast<std::size_t>(end - p)};
+      std::size_t block_size{};
+      std::size_t skip_size{2};
+      if (rest.size() < 2)
+        return static_cast<std::size_t>(p - begin);
+      else if (rest[0] != '\r' || rest[1] != '\n') {
+        block_size = rest.find("\r\n\r\n");
+        if (block_size == std::string_view::npos) {
+          if (rest.size() > max_header_block_size)
+            throw Exception{"multipart header block is too large"};
+          return static_cast<std::size_t>(p - begin);
+        }
+        skip_size = 4;
+      }
+      part_.reset(rest.substr(0, block_size));
+      if (part_handler_)
+        part_handler_(part_);
+      p += block_size + skip_size;
+      state_ = State::data;
+      continue;
+    }
+
+    case State::data: {
+      const auto* const d = find_delimiter();
+      if (d != p && data_handler_)
+        data_handler_({p, static_cast<std::size_t>(d - p)});
+      if (static_cast<std::size_t>(end - d) < delimiter.size())
+        return static_cast<std::size_t>(d - begin);
+      if (part_end_handler_)
+        part_end_handler_();
+      p = d + delimiter.size();
+      state_ = State::delimiter_end;
+      continue;
+    }
+
+    case State::done:
+      // Discarding the epilogue.
+      return static_cast<std::size_t>(end - begin);
+    }
+  }
+  DMITIGR_ASSERT(p == end);
+  return static_cast<std::size_t>(p - begin);
+}
+
+} // namespace dmitigr::fcgi
@@ -0,0 +1,186 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_MULTIPART_HPP
+#define DMITIGR_FCGI_MULTIPART_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @returns The value of the `boundary` parameter of the `content_type` (which
+ * is passed as `CONTENT_TYPE` parameter) if it's of type `multipart`, or
+ * `std::nullopt` otherwise.
+ */
+DMITIGR_FCGI_API std::optional<std::string_view>
+multipart_boundary(std::string_view content_type) noexcept;
+
+/**
+ * @brief A part of a multipart body.
+ *
+ * @remarks The views returned by the member functions are valid only during
+ * the call of the part handler of Multipart_parser.
+ */
+class Multipart_part final {
+public:
+  /// @returns The number of headers of the part.
+  DMITIGR_FCGI_API std::size_t header_count() const noexcept;
+
+  /**
+   * @returns The header of the part by `index`.
+   *
+   * @par Requires
+   * `index < header_count()`.
+   */
+  DMITIGR_FCGI_API std::pair<std::string_view, std::string_view>
+  header(std::size_t index) const;
+
+  /**
+   * @returns The value of the header of the part by the case-insensitive
+   * `name`, or `std::nullopt` if there is no such a header.
+   */
+  DMITIGR_FCGI_API std::optional<std::string_view>
+  header(std::string_view name) const noexcept;
+
+  /// @returns The `name` parameter of the `Content-Disposition` header.
+  DMITIGR_FCGI_API std::string_view name() const noexcept;
+
+  /// @returns The `filename` parameter of the `Content-Disposition` header.
+  DMITIGR_FCGI_API std::optional<std::string_view> filename() const noexcept;
+
+  /**
+   * @returns The value of the `Content-Type` header, or `text/plain` if
+   * there is no such a header.
+   */
+  DMITIGR_FCGI_API std::string_view content_type() const noexcept;
+
+private:
+  friend Multipart_parser;
+
+  std::vector<std::pair<std::string_view, std::string_view>> headers_;
+  std::string_view name_;
+  std::optional<std::string_view> filename_;
+
+  Multipart_part() = default;
+  void reset(std::string_view header_block);
+};
+
+/**
+ * @brief The streaming parser of the multipart body (RFC 7578, RFC 2046).
+ *
+ * @details The body is consumed incrementally and is never buffered as a
+ * whole: the part headers are passed to the part handler, and the part data
+ * is passed to the data handler chunk by chunk as soon as it's known not to
+ * contain the boundary. Thus, the memory usage is constant regardless of the
+ * size of parts. The boundary is searched by `std::memchr()` for the leading
+ * byte of the delimiter followed by the comparison of the rest.
+ *
+ * @par Example
+ * @code
+ * Multipart_parser parser{*multipart_boundary(conn->parameter("CONTENT_TYPE"))};
+ * parser.set_part_handler([&](const Multipart_part& part){...})
+ *   .set_data_handler([&](const std::string_view chunk){...});
+ * parser.parse(conn->in());
+ * @endcode
+ */
+class Multipart_parser final {
+public:
+  /// The handler of the part headers.
+  using Part_handler = std::function<void(const Multipart_part&)>;
+
+  /// The handler of a chunk of the part data.
+  using Data_handler = std::function<void(std::string_view)>;
+
+  /// The handler of the end of part.
+  using Part_end_handler = std::function<void()>;
+
+  /// The maximum size of the header block of a part.
+  static constexpr std::size_t max_header_block_size{16384};
+
+  /**
+   * @brief The constructor.
+   *
+   * @par Requires
+   * `boundary` is 1 to 70 characters long.
+   */
+  DMITIGR_FCGI_API explicit Multipart_parser(std::string_view boundary);
+
+  /// Sets the handler of the part headers.
+  DMITIGR_FCGI_API Multipart_parser& set_part_handler(Part_handler handler);
+
+  /// Sets the handler of a chunk of the part data.
+  DMITIGR_FCGI_API Multipart_parser& set_data_handler(Data_handler handler);
+
+  /// Sets the handler of the end of part.
+  DMITIGR_FCGI_API Multipart_parser& set_part_end_handler(Part_end_handler handler);
+
+  /**
+   * @brief Parses the next `size` bytes of the body.
+   *
+   * @details The handlers are called for the parts recognized so far.
+   *
+   * @throws Exception if the body is malformed.
+   */
+  DMITIGR_FCGI_API void parse(const char* data, std::size_t size);
+
+  /**
+   * @overload
+   *
+   * @details Parses the body read from `in` until the end of stream.
+   *
+   * @throws Exception if the body is malformed or incomplete.
+   *
+   * @par Effects
+   * `is_done()`.
+   */
+  DMITIGR_FCGI_API void parse(std::istream& in);
+
+  /// @returns `true` if the close delimiter is parsed.
+  DMITIGR_FCGI_API bool is_done() const noexcept;
+
+private:
+  enum class State { preamble, delimiter_end, headers, data, done };
+
+  State state_{State::preamble};
+  bool is_body_begin_{true};
+  std::string delimiter_; // CRLF "--" boundary
+  std::string buffer_; // the unconsumed tail of the previous input
+  Multipart_part part_;
+  Part_handler part_handler_;
+  Data_handler data_handler_;
+  Part_end_handler part_end_handler_;
+
+  std::size_t consume(const char* begin, const char* end);
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "multipart.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_MULTIPART_HPP
@@ -0,0 +1,53 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "prepared_response.hpp"
+#include "record_encoder.hpp"
+#include "response_headers.hpp"
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Prepared_response::Prepared_response(
+  const std::string_view content)
+  : content_size_{content.size()}
+{
+  constexpr int request_id{1};
+  Record_encoder encoder;
+  encoder.append_stream(Stream_type::out, request_id, content)
+    .append_end_of_stream(Stream_type::out, request_id)
+    .append_end_request(request_id, 0);
+  data_.reserve(encoder.size());
+  const auto* const iov = encoder.iovecs();
+  for (std::size_t i{}; i < encoder.iovec_count(); ++i)
+    data_.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+}
+
+DMITIGR_FCGI_INLINE Prepared_response::Prepared_response(
+  const Response_headers& headers, const std::string_view body)
+  : Prepared_response{std::string{headers.data()}.append(body)}
+{}
+
+DMITIGR_FCGI_INLINE std::size_t Prepared_response::content_size() const noexcept
+{
+  return content_size_;
+}
+
+DMITIGR_FCGI_INLINE std::string_view Prepared_response::data() const noexcept
+{
+  return data_;
+}
+
+} // namespace dmitigr::fcgi
@@ -0,0 +1,74 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_PREPARED_RESPONSE_HPP
+#define DMITIGR_FCGI_PREPARED_RESPONSE_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief The constant response framed in advance.
+ *
+ * @details The instance holds the complete byte sequence of the response:
+ * the records of type Stream_type::out with the content, the empty record
+ * which terminates the stream and the end-request record. Thus, sending it
+ * by `Server_connection::send()` costs only the patching of the request ID
+ * and of the application status, and a single vectored write. It's intended
+ * for the responses which are the same for every request, such as the replies
+ * of health checks, the error pages or static stubs.
+ *
+ * @remarks The instance is immutable and can be shared between threads.
+ */
+class Prepared_response final {
+public:
+  /**
+   * @brief Constructs the prepared response with the given `content` of the
+   * output stream, i.e. the header block and the body of HTTP response.
+   */
+  DMITIGR_FCGI_API explicit Prepared_response(std::string_view content);
+
+  /// @overload
+  DMITIGR_FCGI_API Prepared_response(const Response_headers& headers,
+    std::string_view body);
+
+  /// @returns The size of the content of the output stream.
+  DMITIGR_FCGI_API std::size_t content_size() const noexcept;
+
+  /**
+   * @returns The framed records with the request ID `1` and the application
+   * status `0`.
+   */
+  DMITIGR_FCGI_API std::string_view data() const noexcept;
+
+private:
+  std::size_t content_size_{};
+  std::string data_;
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "prepared_response.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_PREPARED_RESPONSE_HPP
@@ -0,0 +1,158 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../base/assert.hpp"
+#include "basics.hpp"
+#include "record_encoder.hpp"
+
+#include <algorithm>
+
+namespace dmitigr::fcgi::detail {
+
+/// The padding shared by the records of all the encoders.
+inline constexpr char zero_padding[8]{};
+
+} // namespace dmitigr::fcgi::detail
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Record_encoder&
+Record_encoder::append_begin_request(const int request_id, const Role role,
+  const bool is_keep_conn)
+{
+  const detail::Header header{detail::Record_type::begin_request, request_id,
+    sizeof(detail::Begin_request_body)};
+  const detail::Begin_request_body body{role, is_keep_conn};
+  append_stored(&header, sizeof(header));
+  append_stored(&body, sizeof(body));
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Record_encoder&
+Record_encoder::append_stream(const Stream_type type, const int request_id,
+  std::string_view content)
+{
+  for (; !content.empty(); content.remove_prefix(
+      std::min(content.size(), max_content_length)))
+    append_record(static_cast<int>(type), request_id,
+      content.substr(0, max_content_length));
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Record_encoder&
+Record_encoder::append_end_of_stream(const Stream_type type,
+  const int request_id)
+{
+  append_record(static_cast<int>(type), request_id, {});
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Record_encoder&
+Record_encoder::append_end_request(const int request_id,
+  const int application_status)
+{
+  const detail::End_request_record record{request_id, application_status,
+    detail::Protocol_status::request_complete};
+  append_stored(&record, sizeof(record));
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Record_encoder&
+Record_encoder::append_abort_request(const int request_id)
+{
+  const detail::Header header{detail::Record_type::abort_request, request_id,
+    0};
+  append_stored(&header, sizeof(header));
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Record_encoder&
+Record_encoder::append_get_values(
+  const std::initializer_list<std::string_view> names)
+{
+  std::string content;
+  for (const auto name : names)
+    detail::append_name_value(content, name, {});
+  const detail::Header header{detail::Record_type::get_values,
+    detail::Header::null_request_id, content.size()};
+  append_stored(&header, sizeof(header));
+  append_stored(content.data(), content.size());
+  append_stored(detail::zero_padding, header.padding_length());
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE net::Iovec* Record_encoder::iovecs()
+{
+  iovecs_.resize(pieces_.size());
+  for (std::size_t i{}; i < pieces_.size(); ++i) {
+    const auto& piece = pieces_[i];
+    iovecs_[i] = net::make_iovec(piece.data ? piece.data :
+      storage_.data() + piece.offset, piece.size);
+  }
+  return iovecs_.data();
+}
+
+DMITIGR_FCGI_INLINE std::size_t Record_encoder::iovec_count() const noexcept
+{
+  return pieces_.size();
+}
+
+DMITIGR_FCGI_INLINE std::size_t Record_encoder::size() const noexcept
+{
+  return size_;
+}
+
+DMITIGR_FCGI_INLINE void Record_encoder::clear() noexcept
+{
+  storage_.clear();
+  pieces_.clear();
+  iovecs_.clear();
+  size_ = 0;
+}
+
+DMITIGR_FCGI_INLINE void Record_encoder::append_record(const int type,
+  const int request_id, const std::string_view content)
+{
+  const detail::Header header{detail::Record_type{static_cast<unsigned char>(
+    type)}, request_id, content.size()};
+  append_stored(&header, sizeof(header));
+  append_viewed(content.data(), content.size());
+  append_viewed(detail::zero_padding, header.padding_length());
+}
+
+DMITIGR_FCGI_INLINE void Record_encoder::append_stored(const void* const data,
+  const std::size_t size)
+{
+  if (!pieces_.empty() && !pieces_.back().data)
+    pieces_.back().size += size;
+  else
+    pieces_.push_back({nullptr, storage_.size(), size});
+  storage_.append(static_cast<const char*>(data), size);
+  size_ += size;
+}
+
+DMITIGR_FCGI_INLINE void Record_encoder::append_viewed(const char* const data,
+  const std::size_t size)
+{
+  if (!size)
+    return;
+
+  DMITIGR_ASSERT(data);
+  pieces_.push_back({data, 0, size});
+  size_ += size;
+}
+
+} // namespace dmitigr::fcgi
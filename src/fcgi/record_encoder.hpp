@@ -0,0 +1,156 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_RECORD_ENCODER_HPP
+#define DMITIGR_FCGI_RECORD_ENCODER_HPP
+
+#include "basics.hpp"
+#include "dll.hpp"
+#include "types_fwd.hpp"
+#include "../net/descriptor.hpp"
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief The encoder of FastCGI records into the list of buffers of the
+ * scatter/gather I/O.
+ *
+ * @details The records are appended as the buffers of the headers (which are
+ * stored in the encoder) and the buffers of the content (which are the views
+ * of the data passed to the encoder, i.e. the content is never copied). The
+ * padding refers to the shared buffer of zeros. The adjacent buffers stored
+ * in the encoder are merged into one, so that, for example, the end-of-stream
+ * record and the end-request record are the single buffer.
+ *
+ * The encoder keeps its storage upon clear(), so reusing the encoder doesn't
+ * allocate memory once the storage has grown enough.
+ *
+ * @par Example
+ * @code
+ * Record_encoder encoder;
+ * encoder.append_stream(Stream_type::out, request_id, content)
+ *   .append_end_of_stream(Stream_type::out, request_id)
+ *   .append_end_request(request_id, 0);
+ * net::write_all(io, encoder.iovecs(), encoder.iovec_count());
+ * @endcode
+ *
+ * @remarks The data passed to the encoder must outlive the use of iovecs().
+ */
+class Record_encoder final {
+public:
+  /**
+   * @brief The maximum content length of the records the stream is split to.
+   *
+   * @details It's a multiple of 8, thus only the last record of the stream
+   * might need a padding.
+   */
+  static constexpr std::size_t max_content_length{65528};
+
+  /// Appends the begin-request record.
+  DMITIGR_FCGI_API Record_encoder& append_begin_request(int request_id,
+    Role role, bool is_keep_conn);
+
+  /**
+   * @brief Appends the records of the stream of the given `type` with the
+   * `content` split into the records of at most `max_content_length` bytes.
+   *
+   * @details Nothing is appended if `content` is empty.
+   *
+   * @see append_end_of_stream().
+   */
+  DMITIGR_FCGI_API Record_encoder& append_stream(Stream_type type,
+    int request_id, std::string_view content);
+
+  /// Appends the empty record which terminates the stream of the given `type`.
+  DMITIGR_FCGI_API Record_encoder& append_end_of_stream(Stream_type type,
+    int request_id);
+
+  /**
+   * @brief Appends the end-request record with the protocol status
+   * `FCGI_REQUEST_COMPLETE`.
+   */
+  DMITIGR_FCGI_API Record_encoder& append_end_request(int request_id,
+    int application_status);
+
+  /// Appends the abort-request record.
+  DMITIGR_FCGI_API Record_encoder& append_abort_request(int request_id);
+
+  /**
+   * @brief Appends the get-values record which queries the variables of the
+   * given `names` (for example, `FCGI_MAX_CONNS`).
+   *
+   * @details Unlike the content of the streams, the encoded names are stored
+   * in the encoder.
+   */
+  DMITIGR_FCGI_API Record_encoder&
+  append_get_values(std::initializer_list<std::string_view> names);
+
+  /**
+   * @returns The buffers of the records appended so far.
+   *
+   * @details The buffers are rebuilt by each call, therefore they can be
+   * consumed (for example, by `net::write_all()`) and requested again.
+   *
+   * @remarks The returned pointer is invalidated by the subsequent call of
+   * any non-const member function.
+   */
+  DMITIGR_FCGI_API net::Iovec* iovecs();
+
+  /// @returns The number of buffers returned by iovecs().
+  DMITIGR_FCGI_API std::size_t iovec_count() const noexcept;
+
+  /// @returns The total size of the records appended so far.
+  DMITIGR_FCGI_API std::size_t size() const noexcept;
+
+  /**
+   * @brief Removes the records appended so far.
+   *
+   * @par Effects
+   * `!iovec_count() && !size()`.
+   */
+  DMITIGR_FCGI_API void clear() noexcept;
+
+private:
+  /// A buffer. (The null `data` denotes the `offset` in `storage_`.)
+  struct Piece final {
+    const char* data{};
+    std::size_t offset{};
+    std::size_t size{};
+  };
+
+  std::string storage_; // the headers and the bodies of records
+  std::vector<Piece> pieces_;
+  std::vector<net::Iovec> iovecs_;
+  std::size_t size_{};
+
+  void append_record(int type, int request_id, std::string_view content);
+  void append_stored(const void* data, std::size_t size);
+  void append_viewed(const char* data, std::size_t size);
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "record_encoder.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_RECORD_ENCODER_HPP
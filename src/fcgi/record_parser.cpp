@@ -0,0 +1,177 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exceptions.hpp"
+#include "record_parser.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Record_parser&
+Record_parser::set_header_handler(Header_handler handler)
+{
+  header_handler_ = std::move(handler);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Record_parser&
+Record_parser::set_content_handler(Content_handler handler)
+{
+  content_handler_ = std::move(handler);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Record_parser&
+Record_parser::set_record_end_handler(Record_end_handler handler)
+{
+  record_end_handler_ = std::move(handler);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Record_parser&
+Record_parser::set_management_handler(Management_handler handler)
+{
+  management_handler_ = std::move(handler);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE void Record_parser::parse(const char* data,
+  std::size_t size)
+{
+  while (size) {
+    switch (state_) {
+    case State::header:
+      if (!header_size_ && size >= sizeof(header_data_)) {
+        // The header is decoded in place.
+        begin_record(data);
+        data += sizeof(header_data_);
+        size -= sizeof(header_data_);
+      } else {
+        const auto count = std::min(sizeof(header_data_) - header_size_, size);
+        std::memcpy(header_data_ + header_size_, data, count);
+        header_size_ += count;
+        data += count;
+        size -= count;
+        if (header_size_ == sizeof(header_data_)) {
+          header_size_ = 0;
+          begin_record(header_data_);
+        }
+      }
+      break;
+
+    case State::content: {
+      const auto count = std::min(remaining_, size);
+      remaining_ -= count;
+      if (!header_.is_management()) {
+        if (content_handler_)
+          content_handler_(header_, {data, count});
+        data += count;
+        size -= count;
+        if (!remaining_)
+          end_content();
+      } else if (!remaining_ && management_content_.empty()) {
+        // The content is entirely within the chunk.
+        if (management_handler_)
+          management_handler_(header_, {data, count});
+        data += count;
+        size -= count;
+        end_content();
+      } else {
+        management_content_.append(data, count);
+        data += count;
+        size -= count;
+        if (!remaining_) {
+          if (management_handler_)
+            management_handler_(header_, management_content_);
+          management_content_.clear();
+          end_content();
+        }
+      }
+      break;
+    }
+
+    case State::padding: {
+      const auto count = std::min(remaining_, size);
+      remaining_ -= count;
+      data += count;
+      size -= count;
+      if (!remaining_)
+        end_record();
+      break;
+    }
+    }
+  }
+}
+
+DMITIGR_FCGI_INLINE bool Record_parser::is_record_boundary() const noexcept
+{
+  return state_ == State::header && !header_size_;
+}
+
+DMITIGR_FCGI_INLINE void Record_parser::reset() noexcept
+{
+  state_ = State::header;
+  header_ = {};
+  remaining_ = 0;
+  header_size_ = 0;
+  management_content_.clear();
+}
+
+DMITIGR_FCGI_INLINE void Record_parser::begin_record(const char* const header)
+{
+  const auto byte = [header](const std::size_t i) noexcept
+  {
+    return static_cast<unsigned char>(header[i]);
+  };
+  if (byte(0) != 1)
+    throw Exception{"FastCGI protocol violation"};
+
+  header_.type = byte(1);
+  header_.request_id = byte(2) << 8 | byte(3);
+  header_.content_length = static_cast<std::size_t>(byte(4) << 8 | byte(5));
+  header_.padding_length = byte(6);
+  if (!header_.is_management() && header_handler_)
+    header_handler_(header_);
+
+  if (header_.content_length) {
+    state_ = State::content;
+    remaining_ = header_.content_length;
+  } else {
+    if (header_.is_management() && management_handler_)
+      management_handler_(header_, {});
+    end_content();
+  }
+}
+
+DMITIGR_FCGI_INLINE void Record_parser::end_content()
+{
+  if (header_.padding_length) {
+    state_ = State::padding;
+    remaining_ = header_.padding_length;
+  } else
+    end_record();
+}
+
+DMITIGR_FCGI_INLINE void Record_parser::end_record()
+{
+  state_ = State::header;
+  if (!header_.is_management() && record_end_handler_)
+    record_end_handler_(header_);
+}
+
+} // namespace dmitigr::fcgi
@@ -0,0 +1,153 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_RECORD_PARSER_HPP
+#define DMITIGR_FCGI_RECORD_PARSER_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace dmitigr::fcgi {
+
+/// A header of the FastCGI record.
+struct Record_header final {
+  /// The record type (for example, `1` is `FCGI_BEGIN_REQUEST`).
+  int type{};
+
+  /// The request ID. (`0` denotes the management record.)
+  int request_id{};
+
+  /// The content length.
+  std::size_t content_length{};
+
+  /// The padding length.
+  std::size_t padding_length{};
+
+  /// @returns `true` if this is the header of the management record.
+  bool is_management() const noexcept
+  {
+    return !request_id;
+  }
+};
+
+/**
+ * @brief The incremental push parser of the stream of FastCGI records.
+ *
+ * @details The data is passed in chunks of arbitrary size (a record can be
+ * split across the chunks anyhow), and the events are passed to the handlers:
+ *   -# for each record of the request: the header, the spans of the content,
+ *   and the end of record (after the padding is skipped);
+ *   -# for each management record: the whole record at once.
+ *
+ * The spans of the content are the views of the data passed to parse(), i.e.
+ * the content is never copied. The only exception is the content of the
+ * management record split across the chunks, which is accumulated. Thus, the
+ * parser doesn't allocate memory when processing the records of the requests.
+ * The header which is entirely within the chunk is decoded in place.
+ *
+ * @par Example
+ * @code
+ * Record_parser parser;
+ * parser.set_content_handler([&](const Record_header& header,
+ *   const std::string_view content){...});
+ * while (const auto size = read(buf, sizeof(buf)))
+ *   parser.parse(buf, size);
+ * @endcode
+ */
+class Record_parser final {
+public:
+  /// The handler of the header of the record of a request.
+  using Header_handler = std::function<void(const Record_header&)>;
+
+  /// The handler of a span of the content of the record of a request.
+  using Content_handler =
+    std::function<void(const Record_header&, std::string_view)>;
+
+  /// The handler of the end of the record of a request.
+  using Record_end_handler = std::function<void(const Record_header&)>;
+
+  /// The handler of the management record.
+  using Management_handler =
+    std::function<void(const Record_header&, std::string_view)>;
+
+  /// Sets the handler of the header of the record of a request.
+  DMITIGR_FCGI_API Record_parser& set_header_handler(Header_handler handler);
+
+  /// Sets the handler of a span of the content of the record of a request.
+  DMITIGR_FCGI_API Record_parser& set_content_handler(Content_handler handler);
+
+  /// Sets the handler of the end of the record of a request.
+  DMITIGR_FCGI_API Record_parser&
+  set_record_end_handler(Record_end_handler handler);
+
+  /// Sets the handler of the management record.
+  DMITIGR_FCGI_API Record_parser&
+  set_management_handler(Management_handler handler);
+
+  /**
+   * @brief Parses the next `size` bytes of the stream of records.
+   *
+   * @details The handlers are called for the records recognized so far.
+   *
+   * @throws Exception if the version of the record is not `1`.
+   */
+  DMITIGR_FCGI_API void parse(const char* data, std::size_t size);
+
+  /**
+   * @returns `true` if the data parsed so far ends at the boundary of the
+   * records.
+   */
+  DMITIGR_FCGI_API bool is_record_boundary() const noexcept;
+
+  /**
+   * @brief Resets the state of the parser (the handlers are kept).
+   *
+   * @par Effects
+   * `is_record_boundary()`.
+   */
+  DMITIGR_FCGI_API void reset() noexcept;
+
+private:
+  enum class State { header, content, padding };
+
+  State state_{State::header};
+  Record_header header_;
+  std::size_t remaining_{}; // of the content or padding
+  std::size_t header_size_{}; // of the partial header
+  char header_data_[8]{};
+  std::string management_content_; // split across the chunks
+  Header_handler header_handler_;
+  Content_handler content_handler_;
+  Record_end_handler record_end_handler_;
+  Management_handler management_handler_;
+
+  void begin_record(const char* header);
+  void end_content();
+  void end_record();
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "record_parser.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_RECORD_PARSER_HPP
@@ -0,0 +1,187 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../base/assert.hpp"
+#include "connection.hpp"
+#include "exceptions.hpp"
+#include "prepared_response.hpp"
+#include "response_cache.hpp"
+#include "server_connection.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE void
+Response_cache::Shard::erase(const std::list<Entry>::iterator entry)
+{
+  memory_usage -= entry->size;
+  index.erase(entry->key);
+  entries.erase(entry);
+}
+
+DMITIGR_FCGI_INLINE Response_cache::Response_cache(
+  std::vector<std::string> parameters, const std::size_t memory_limit,
+  const std::size_t shard_count)
+  : parameters_{std::move(parameters)}
+  , memory_limit_{memory_limit}
+  , shard_memory_limit_{shard_count ? memory_limit / shard_count : 0}
+  , shards_{shard_count ? std::make_unique<Shard[]>(shard_count) : nullptr}
+  , shard_count_{shard_count}
+{
+  if (!shard_count)
+    throw Exception{"invalid shard count of FastCGI response cache"};
+}
+
+DMITIGR_FCGI_INLINE const std::vector<std::string>&
+Response_cache::parameters() const noexcept
+{
+  return parameters_;
+}
+
+DMITIGR_FCGI_INLINE std::size_t Response_cache::memory_limit() const noexcept
+{
+  return memory_limit_;
+}
+
+DMITIGR_FCGI_INLINE std::string Response_cache::key(const Connection& conn) const
+{
+  // Each parameter is encoded as either 0 if absent, or as 1 followed by the
+  // length (4 bytes) and the value.
+  std::string result;
+  for (const auto& name : parameters_) {
+    if (const auto index = conn.parameter_index(name)) {
+      const auto value = conn.parameter(*index);
+      const auto size = static_cast<std::uint32_t>(value.size());
+      result.push_back('\1');
+      result.append(reinterpret_cast<const char*>(&size), sizeof(size));
+      result.append(value);
+    } else
+      result.push_back('\0');
+  }
+  return result;
+}
+
+DMITIGR_FCGI_INLINE std::shared_ptr<const Prepared_response>
+Response_cache::find(const std::string& key)
+{
+  auto& shard = this->shard(key);
+  const std::lock_guard lg{shard.mutex};
+  if (const auto i = shard.index.find(key); i != shard.index.end()) {
+    const auto entry = i->second;
+    if (Clock::now() < entry->expires_at) {
+      shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+      return entry->response;
+    } else
+      shard.erase(entry);
+  }
+  return nullptr;
+}
+
+DMITIGR_FCGI_INLINE bool Response_cache::send(Server_connection& conn)
+{
+  if (const auto response = find(key(conn))) {
+    conn.send(*response);
+    return true;
+  } else
+    return false;
+}
+
+DMITIGR_FCGI_INLINE bool Response_cache::insert(std::string key,
+  std::shared_ptr<const Prepared_response> response,
+  const std::chrono::milliseconds ttl)
+{
+  if (!response)
+    throw Exception{"cannot insert null response to FastCGI response cache"};
+
+  const auto size = key.size() + response->data().size();
+  auto& shard = this->shard(key);
+  const std::lock_guard lg{shard.mutex};
+  if (const auto i = shard.index.find(key); i != shard.index.end())
+    shard.erase(i->second);
+  if (size > shard_memory_limit_)
+    return false;
+
+  // Evicting the expired and the least recently used responses.
+  const auto now = Clock::now();
+  while (!shard.entries.empty() &&
+    (shard.memory_usage + size > shard_memory_limit_ ||
+      shard.entries.back().expires_at <= now))
+    shard.erase(std::prev(shard.entries.end()));
+
+  shard.entries.push_front({std::move(key), std::move(response), now + ttl,
+    size});
+  const auto entry = shard.entries.begin();
+  shard.index.emplace(entry->key, entry);
+  shard.memory_usage += size;
+  DMITIGR_ASSERT(shard.memory_usage <= shard_memory_limit_);
+  return true;
+}
+
+DMITIGR_FCGI_INLINE bool Response_cache::erase(const std::string& key)
+{
+  auto& shard = this->shard(key);
+  const std::lock_guard lg{shard.mutex};
+  if (const auto i = shard.index.find(key); i != shard.index.end()) {
+    shard.erase(i->second);
+    return true;
+  } else
+    return false;
+}
+
+DMITIGR_FCGI_INLINE void Response_cache::clear()
+{
+  for (std::size_t i{}; i < shard_count_; ++i) {
+    auto& shard = shards_[i];
+    const std::lock_guard lg{shard.mutex};
+    shard.index.clear();
+    shard.entries.clear();
+    shard.memory_usage = 0;
+  }
+}
+
+DMITIGR_FCGI_INLINE std::size_t Response_cache::size() const
+{
+  std::size_t result{};
+  for (std::size_t i{}; i < shard_count_; ++i) {
+    const auto& shard = shards_[i];
+    const std::lock_guard lg{shard.mutex};
+    result += shard.entries.size();
+  }
+  return result;
+}
+
+DMITIGR_FCGI_INLINE std::size_t Response_cache::memory_usage() const
+{
+  std::size_t result{};
+  for (std::size_t i{}; i < shard_count_; ++i) {
+    const auto& shard = shards_[i];
+    const std::lock_guard lg{shard.mutex};
+    result += shard.memory_usage;
+  }
+  return result;
+}
+
+DMITIGR_FCGI_INLINE Response_cache::Shard&
+Response_cache::shard(const std::string& key) const noexcept
+{
+  return shards_[std::hash<std::string>{}(key) % shard_count_];
+}
+
+} // namespace dmitigr::fcgi
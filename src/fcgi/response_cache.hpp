@@ -0,0 +1,183 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_RESPONSE_CACHE_HPP
+#define DMITIGR_FCGI_RESPONSE_CACHE_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief The in-process cache of prepared responses.
+ *
+ * @details The responses are keyed by the values of the selected parameters
+ * of the request (for example, `REQUEST_METHOD`, `REQUEST_URI` and
+ * `HTTP_ACCEPT_ENCODING`) and expire after the time-to-live given upon the
+ * insertion. The cache is split into the shards, each of which is guarded by
+ * its own mutex and evicts the least recently used responses if its part of
+ * the memory limit is exceeded. Thus, the cache can be shared between the
+ * threads which serve the connections. A hit is served right after accepting
+ * the connection, for example:
+ * @code
+ * if (const auto conn = listener.accept()) {
+ *   if (cache.send(*conn))
+ *     return; // the handler is skipped
+ *   const auto response = std::make_shared<const Prepared_response>(...);
+ *   cache.insert(cache.key(*conn), response, std::chrono::seconds{10});
+ *   conn->send(*response);
+ * }
+ * @endcode
+ */
+class Response_cache final {
+public:
+  /// The clock of the time-to-live.
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief The constructor.
+   *
+   * @param parameters The names of the parameters the key consists of.
+   * @param memory_limit The maximum total size of the cached responses and
+   * their keys.
+   * @param shard_count The number of shards.
+   *
+   * @par Requires
+   * `shard_count > 0`.
+   */
+  DMITIGR_FCGI_API Response_cache(std::vector<std::string> parameters,
+    std::size_t memory_limit, std::size_t shard_count = 16);
+
+  /// Non copy-constructible.
+  Response_cache(const Response_cache&) = delete;
+
+  /// Non copy-assignable.
+  Response_cache& operator=(const Response_cache&) = delete;
+
+  /// Non move-constructible.
+  Response_cache(Response_cache&&) = delete;
+
+  /// Non move-assignable.
+  Response_cache& operator=(Response_cache&&) = delete;
+
+  /// @returns The names of the parameters the key consists of.
+  DMITIGR_FCGI_API const std::vector<std::string>& parameters() const noexcept;
+
+  /// @returns The maximum total size of the cached responses and their keys.
+  DMITIGR_FCGI_API std::size_t memory_limit() const noexcept;
+
+  /**
+   * @returns The key of the request of `conn`. (The absent parameters and the
+   * parameters with empty values are distinguished.)
+   */
+  DMITIGR_FCGI_API std::string key(const Connection& conn) const;
+
+  /**
+   * @returns The unexpired response by the `key`, or `nullptr` if there is
+   * no such a response.
+   *
+   * @par Effects
+   * The found response becomes the most recently used one, and the expired
+   * one is removed.
+   */
+  DMITIGR_FCGI_API std::shared_ptr<const Prepared_response>
+  find(const std::string& key);
+
+  /**
+   * @brief Sends the cached response for the request of `conn` (if any) by
+   * `conn.send()`.
+   *
+   * @returns `true` if the response is sent.
+   */
+  DMITIGR_FCGI_API bool send(Server_connection& conn);
+
+  /**
+   * @brief Caches the `response` by the `key` for the `ttl`, replacing the
+   * response cached by the `key` before (if any).
+   *
+   * @details The least recently used responses of the shard are evicted if
+   * the limit of memory usage of the shard is exceeded.
+   *
+   * @returns `false` if the size of `response` exceeds the limit of memory
+   * usage of the shard so it's not cached.
+   *
+   * @par Requires
+   * `response`.
+   */
+  DMITIGR_FCGI_API bool insert(std::string key,
+    std::shared_ptr<const Prepared_response> response,
+    std::chrono::milliseconds ttl);
+
+  /**
+   * @brief Removes the response by the `key`.
+   *
+   * @returns `true` if the response was removed.
+   */
+  DMITIGR_FCGI_API bool erase(const std::string& key);
+
+  /// Removes all the responses.
+  DMITIGR_FCGI_API void clear();
+
+  /// @returns The number of the cached responses (including the expired ones).
+  DMITIGR_FCGI_API std::size_t size() const;
+
+  /// @returns The total size of the cached responses and their keys.
+  DMITIGR_FCGI_API std::size_t memory_usage() const;
+
+private:
+  struct Entry final {
+    std::string key;
+    std::shared_ptr<const Prepared_response> response;
+    Clock::time_point expires_at;
+    std::size_t size{};
+  };
+
+  struct Shard final {
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // from the most to the least recently used
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    std::size_t memory_usage{};
+
+    void erase(std::list<Entry>::iterator entry);
+  };
+
+  std::vector<std::string> parameters_;
+  std::size_t memory_limit_{};
+  std::size_t shard_memory_limit_{};
+  std::unique_ptr<Shard[]> shards_;
+  std::size_t shard_count_{};
+
+  Shard& shard(const std::string& key) const noexcept;
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "response_cache.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_RESPONSE_CACHE_HPP
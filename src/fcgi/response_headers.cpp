@@ -0,0 +1,158 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "exceptions.hpp"
+#include "response_headers.hpp"
+#include "writer.hpp"
+
+#include <charconv>
+
+namespace dmitigr::fcgi::detail {
+
+/**
+ * @returns The prepared status line of the common `status` with the standard
+ * reason phrase, or the empty view if `status` is not common.
+ */
+inline std::string_view status_line(const int status) noexcept
+{
+  switch (status) {
+  case 200: return "Status: 200 OK\r\n";
+  case 201: return "Status: 201 Created\r\n";
+  case 202: return "Status: 202 Accepted\r\n";
+  case 204: return "Status: 204 No Content\r\n";
+  case 206: return "Status: 206 Partial Content\r\n";
+  case 301: return "Status: 301 Moved Permanently\r\n";
+  case 302: return "Status: 302 Found\r\n";
+  case 303: return "Status: 303 See Other\r\n";
+  case 304: return "Status: 304 Not Modified\r\n";
+  case 307: return "Status: 307 Temporary Redirect\r\n";
+  case 308: return "Status: 308 Permanent Redirect\r\n";
+  case 400: return "Status: 400 Bad Request\r\n";
+  case 401: return "Status: 401 Unauthorized\r\n";
+  case 403: return "Status: 403 Forbidden\r\n";
+  case 404: return "Status: 404 Not Found\r\n";
+  case 405: return "Status: 405 Method Not Allowed\r\n";
+  case 409: return "Status: 409 Conflict\r\n";
+  case 410: return "Status: 410 Gone\r\n";
+  case 412: return "Status: 412 Precondition Failed\r\n";
+  case 413: return "Status: 413 Payload Too Large\r\n";
+  case 415: return "Status: 415 Unsupported Media Type\r\n";
+  case 422: return "Status: 422 Unprocessable Entity\r\n";
+  case 429: return "Status: 429 Too Many Requests\r\n";
+  case 500: return "Status: 500 Internal Server Error\r\n";
+  case 501: return "Status: 501 Not Implemented\r\n";
+  case 502: return "Status: 502 Bad Gateway\r\n";
+  case 503: return "Status: 503 Service Unavailable\r\n";
+  case 504: return "Status: 504 Gateway Timeout\r\n";
+  default: return {};
+  }
+}
+
+/// @returns `true` if `str` contains either CR or LF.
+inline bool has_line_break(const std::string_view str) noexcept
+{
+  return str.find_first_of("\r\n") != std::string_view::npos;
+}
+
+} // namespace dmitigr::fcgi::detail
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Response_headers::Response_headers()
+  : Response_headers{200}
+{}
+
+DMITIGR_FCGI_INLINE Response_headers::Response_headers(const int status,
+  const std::string_view reason)
+{
+  block_.reserve(256);
+  block_.append("\r\n");
+  set_status(status, reason);
+}
+
+DMITIGR_FCGI_INLINE int Response_headers::status() const noexcept
+{
+  return status_;
+}
+
+DMITIGR_FCGI_INLINE Response_headers&
+Response_headers::set_status(const int status, const std::string_view reason)
+{
+  if (!(100 <= status && status <= 999))
+    throw Exception{"invalid HTTP response status"};
+  else if (detail::has_line_break(reason))
+    throw Exception{"invalid HTTP response reason phrase"};
+
+  std::string formatted;
+  auto line = reason.empty() ? detail::status_line(status) : std::string_view{};
+  if (line.empty()) {
+    char code[3];
+    std::to_chars(code, code + sizeof(code), status);
+    formatted.append("Status: ").append(code, sizeof(code));
+    if (!reason.empty())
+      formatted.append(" ").append(reason);
+    formatted.append("\r\n");
+    line = formatted;
+  }
+  block_.replace(0, status_line_size_, line);
+  status_line_size_ = line.size();
+  status_ = status;
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Response_headers&
+Response_headers::append(const std::string_view name,
+  const std::string_view value)
+{
+  if (name.empty() || name.find_first_of(":\r\n \t") != std::string_view::npos)
+    throw Exception{"invalid HTTP response header name"};
+  else if (detail::has_line_break(value))
+    throw Exception{"invalid HTTP response header value"};
+
+  // Inserting before the terminating empty line.
+  block_.resize(block_.size() - 2);
+  block_.append(name).append(": ").append(value).append("\r\n\r\n");
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Response_headers&
+Response_headers::append_content_type(const std::string_view value)
+{
+  return append("Content-Type", value);
+}
+
+DMITIGR_FCGI_INLINE Response_headers&
+Response_headers::append_content_length(const std::size_t value)
+{
+  char buffer[20];
+  const auto* const end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+  return append("Content-Length",
+    std::string_view{buffer, static_cast<std::size_t>(end - buffer)});
+}
+
+DMITIGR_FCGI_INLINE std::string_view Response_headers::data() const noexcept
+{
+  return block_;
+}
+
+DMITIGR_FCGI_INLINE const Response_headers&
+Response_headers::write(std::ostream& out) const
+{
+  Writer{out}.write_whole(block_.data(), block_.size());
+  return *this;
+}
+
+} // namespace dmitigr::fcgi
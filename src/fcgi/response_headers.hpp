@@ -0,0 +1,117 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_RESPONSE_HEADERS_HPP
+#define DMITIGR_FCGI_RESPONSE_HEADERS_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief The header block of HTTP response (CGI response headers).
+ *
+ * @details The block is built in a single contiguous storage: the status lines
+ * of the common status codes and the names of the common headers are prepared
+ * in advance and copied as is, and only the values are formatted. The block
+ * always ends with the empty line, so it can be written as a whole right
+ * before the body, for example:
+ * @code
+ * Response_headers{}.append_content_type("text/plain")
+ *   .append_content_length(body.size()).write(conn->out());
+ * conn->out() << body;
+ * @endcode
+ * If the block and the body are small enough they are sent in the same record,
+ * along with the end records of the request, i.e. by a single system call.
+ */
+class Response_headers final {
+public:
+  /**
+   * @brief Constructs the header block with the status `200 OK`.
+   */
+  DMITIGR_FCGI_API Response_headers();
+
+  /**
+   * @brief Constructs the header block with the given status.
+   *
+   * @see set_status().
+   */
+  DMITIGR_FCGI_API explicit Response_headers(int status,
+    std::string_view reason = {});
+
+  /// @returns The status code.
+  DMITIGR_FCGI_API int status() const noexcept;
+
+  /**
+   * @brief Sets the status.
+   *
+   * @param reason The reason phrase. If empty, the standard reason phrase of
+   * the `status` is used (if any).
+   *
+   * @par Requires
+   * `100 <= status && status <= 999` and `reason` contains neither CR nor LF.
+   */
+  DMITIGR_FCGI_API Response_headers& set_status(int status,
+    std::string_view reason = {});
+
+  /**
+   * @brief Appends the header field.
+   *
+   * @par Requires
+   * `name` is not empty and contains neither `:`, CR, LF nor spaces, and
+   * `value` contains neither CR nor LF.
+   */
+  DMITIGR_FCGI_API Response_headers& append(std::string_view name,
+    std::string_view value);
+
+  /// Appends the `Content-Type` header field.
+  DMITIGR_FCGI_API Response_headers& append_content_type(std::string_view value);
+
+  /// Appends the `Content-Length` header field.
+  DMITIGR_FCGI_API Response_headers& append_content_length(std::size_t value);
+
+  /// @returns The header block including the terminating empty line.
+  DMITIGR_FCGI_API std::string_view data() const noexcept;
+
+  /**
+   * @brief Writes the header block to `out` by using Writer.
+   *
+   * @details If `out` is the output stream of Server_connection and the
+   * block doesn't fit in the free space of its put area, the stream is flushed
+   * before. Thus, unless the block is larger than the put area, it's copied
+   * there at once and never split between records (see Writer::write_whole()).
+   */
+  DMITIGR_FCGI_API const Response_headers& write(std::ostream& out) const;
+
+private:
+  int status_{};
+  std::size_t status_line_size_{};
+  std::string block_;
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "response_headers.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_RESPONSE_HEADERS_HPP
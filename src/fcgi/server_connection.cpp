@@ -15,21 +15,279 @@
 // limitations under the License.
 
 #include "../base/assert.hpp"
+#include "../net/descriptor.hpp"
 #include "basics.hpp"
 #include "exceptions.hpp"
+#include "listener_options.hpp"
 #include "server_connection.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#ifdef __linux__
+#include "../os/exceptions.hpp"
+
+#include <cerrno>
+#include <csignal>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
 namespace dmitigr::fcgi::detail {
 
+#ifdef __linux__
+/// A pipe to move the data between descriptors by `splice()`.
+class Splice_pipe final {
+public:
+  /// The destructor.
+  ~Splice_pipe()
+  {
+    ::close(fds_[0]);
+    ::close(fds_[1]);
+  }
+
+  /// The constructor.
+  Splice_pipe()
+  {
+    if (::pipe2(fds_, O_CLOEXEC))
+      throw os::Sys_exception{"cannot create pipe"};
+    const int capacity = ::fcntl(fds_[1], F_GETPIPE_SZ);
+    if (capacity <= 0) {
+      ::close(fds_[0]);
+      ::close(fds_[1]);
+      throw os::Sys_exception{"cannot get capacity of pipe"};
+    }
+    capacity_ = static_cast<std::size_t>(capacity);
+  }
+
+  Splice_pipe(const Splice_pipe&) = delete;
+  Splice_pipe& operator=(const Splice_pipe&) = delete;
+
+  /// @returns The capacity of the pipe.
+  std::size_t capacity() const noexcept
+  {
+    return capacity_;
+  }
+
+  /// @returns The descriptor of the read end.
+  int read_end() const noexcept
+  {
+    return fds_[0];
+  }
+
+  /// @returns The descriptor of the write end.
+  int write_end() const noexcept
+  {
+    return fds_[1];
+  }
+
+private:
+  int fds_[2]{-1, -1};
+  std::size_t capacity_{};
+};
+
+/**
+ * @brief Blocks `SIGPIPE` for the calling thread for the lifetime of the
+ * instance.
+ *
+ * @details Unlike `send()`, `splice()` to a socket has no `MSG_NOSIGNAL`, so
+ * `SIGPIPE` raised upon writing to the socket closed by the peer is consumed
+ * upon the destruction (unless it was pending before), and the write fails
+ * with `EPIPE` instead of killing the process.
+ */
+class Sigpipe_guard final {
+public:
+  /// The destructor.
+  ~Sigpipe_guard()
+  {
+    if (!is_pending_) {
+      sigset_t pending;
+      if (!::sigpending(&pending) && ::sigismember(&pending, SIGPIPE) == 1) {
+        sigset_t sigpipe;
+        ::sigemptyset(&sigpipe);
+        ::sigaddset(&sigpipe, SIGPIPE);
+        const timespec timeout{};
+        while (::sigtimedwait(&sigpipe, nullptr, &timeout) < 0 && errno == EINTR);
+      }
+    }
+    ::pthread_sigmask(SIG_SETMASK, &old_mask_, nullptr);
+  }
+
+  /// The constructor.
+  Sigpipe_guard()
+  {
+    sigset_t sigpipe;
+    ::sigemptyset(&sigpipe);
+    ::sigaddset(&sigpipe, SIGPIPE);
+    sigset_t pending;
+    is_pending_ = !::sigpending(&pending) &&
+      ::sigismember(&pending, SIGPIPE) == 1;
+    if (::pthread_sigmask(SIG_BLOCK, &sigpipe, &old_mask_))
+      throw Exception{"cannot block SIGPIPE"};
+  }
+
+  Sigpipe_guard(const Sigpipe_guard&) = delete;
+  Sigpipe_guard& operator=(const Sigpipe_guard&) = delete;
+
+private:
+  sigset_t old_mask_;
+  bool is_pending_{};
+};
+#endif
+
+/**
+ * @brief A share of the limited number of requests in progress.
+ *
+ * @details The counter of requests in progress is decremented upon the
+ * destruction of the ticket.
+ */
+class Admission_ticket final {
+public:
+  /// Constructs the invalid ticket.
+  Admission_ticket() = default;
+
+  /**
+   * @returns The valid ticket if the value of `counter` is less than the
+   * `limit` (if any), or the invalid ticket otherwise.
+   *
+   * @par Effects
+   * The value of `counter` is incremented if the ticket is valid.
+   */
+  static Admission_ticket acquire(
+    std::shared_ptr<std::atomic<std::size_t>> counter,
+    const std::optional<std::size_t> limit) noexcept
+  {
+    DMITIGR_ASSERT(counter);
+    const auto count = counter->fetch_add(1);
+    if (limit && count >= *limit) {
+      counter->fetch_sub(1);
+      return Admission_ticket{};
+    }
+    return Admission_ticket{std::move(counter)};
+  }
+
+  /// The destructor.
+  ~Admission_ticket()
+  {
+    if (counter_)
+      counter_->fetch_sub(1);
+  }
+
+  /// Non copy-constructible.
+  Admission_ticket(const Admission_ticket&) = delete;
+
+  /// Non copy-assignable.
+  Admission_ticket& operator=(const Admission_ticket&) = delete;
+
+  /// Move-constructible.
+  Admission_ticket(Admission_ticket&&) = default;
+
+  /// Non move-assignable.
+  Admission_ticket& operator=(Admission_ticket&&) = delete;
+
+  /// @returns `true` if the ticket is valid.
+  explicit operator bool() const noexcept
+  {
+    return static_cast<bool>(counter_);
+  }
+
+private:
+  std::shared_ptr<std::atomic<std::size_t>> counter_;
+
+  explicit Admission_ticket(std::shared_ptr<std::atomic<std::size_t>> counter)
+    noexcept
+    : counter_{std::move(counter)}
+  {}
+};
+
+/**
+ * @brief A queue of the output which cannot be written to a non-blocking
+ * descriptor immediately.
+ */
+class Output_backlog final {
+public:
+  /// @returns `true` if the backlog is empty.
+  bool is_empty() const noexcept
+  {
+    return !size_;
+  }
+
+  /// @returns The number of bytes in the backlog.
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  /// Appends the data of the `count` buffers pointed by `iov`.
+  void push(const net::Iovec* const iov, const std::size_t count)
+  {
+    for (std::size_t i{}; i < count; ++i) {
+      if (iov[i].iov_len) {
+        chunks_.emplace_back(static_cast<const char*>(iov[i].iov_base),
+          iov[i].iov_len);
+        size_ += iov[i].iov_len;
+      }
+    }
+  }
+
+  /**
+   * @brief Writes the backlog to `io` until either the backlog is empty or
+   * the write would block.
+   *
+   * @returns `is_empty()`.
+   */
+  bool drain(net::Descriptor& io)
+  {
+    while (!chunks_.empty()) {
+      const auto& chunk = chunks_.front();
+      DMITIGR_ASSERT(offset_ < chunk.size());
+      const auto len = static_cast<std::streamsize>(chunk.size() - offset_);
+      const auto count = io.write(chunk.data() + offset_, len);
+      DMITIGR_ASSERT(0 <= count && count <= len);
+      size_ -= static_cast<std::size_t>(count);
+      if (count == len) {
+        chunks_.pop_front();
+        offset_ = 0;
+      } else if (count > 0)
+        offset_ += static_cast<std::size_t>(count);
+      else
+        break; // would block
+    }
+    return is_empty();
+  }
+
+private:
+  std::deque<std::string> chunks_;
+  std::size_t offset_{}; // of the first chunk
+  std::size_t size_{};
+};
+
 /// The base implementation of the Server_connection.
 class iServer_connection : public Server_connection {
 public:
   /// The constructor.
   explicit iServer_connection(std::unique_ptr<net::Descriptor> io,
-    const Role role, const int request_id, const bool is_keep_connection)
-    : is_keep_connection_{is_keep_connection}
+    const Role role, const int request_id, const bool is_keep_connection,
+    const Listener_options& options, std::shared_ptr<Flush_timer> flush_timer,
+    Admission_ticket admission_ticket)
+    : admission_ticket_{std::move(admission_ticket)}
+    , is_keep_connection_{is_keep_connection}
     , role_{role}
     , request_id_{request_id}
+    , output_backlog_limit_{options.output_backlog_limit()}
+    , zerocopy_threshold_{options.zerocopy_threshold()}
+    , max_concurrent_request_count_{options.max_concurrent_request_count()}
+    , flush_timer_{std::move(flush_timer)}
   {
     io_ = std::move(io);
     DMITIGR_ASSERT(io_);
@@ -89,21 +347,281 @@ public:
     application_status_ = status;
   }
 
+  bool is_aborted() const noexcept override
+  {
+    return is_aborted_;
+  }
+
+  void set_abort_handler(Abort_handler handler) override
+  {
+    std::unique_lock lk{abort_mutex_};
+    if (is_aborted_) {
+      lk.unlock();
+      if (handler)
+        handler();
+    } else
+      abort_handler_ = std::move(handler);
+  }
+
   bool is_keep_connection() const
   {
     return is_keep_connection_;
   }
 
+  /// @returns The maximum number of requests served concurrently.
+  std::size_t max_concurrent_request_count() const noexcept
+  {
+    return max_concurrent_request_count_;
+  }
+
+  /// Marks the request as aborted and calls the abort handler (once).
+  void abort()
+  {
+    Abort_handler handler;
+    {
+      const std::lock_guard lg{abort_mutex_};
+      if (is_aborted_)
+        return;
+      is_aborted_ = true;
+      handler = std::move(abort_handler_);
+    }
+    if (handler)
+      handler();
+  }
+
+  /// @returns The parameters.
+  const Names_values& parameters() const noexcept
+  {
+    return parameters_;
+  }
+
+  // ---------------------------------------------------------------------------
+  // I/O
+  // ---------------------------------------------------------------------------
+
+  /// @returns `true` if the descriptor can be read without blocking.
+  bool is_readable() const
+  {
+    using Sr = net::Socket_readiness;
+    const auto socket = static_cast<net::Socket_native>(io_->native_handle());
+    return net::poll(socket, Sr::read_ready, std::chrono::milliseconds{0}) !=
+      Sr::unready;
+  }
+
+  /**
+   * @brief Reads from the descriptor.
+   *
+   * @details If the descriptor is non-blocking waits until it becomes
+   * readable, draining the output backlog meanwhile.
+   *
+   * @returns Number of bytes read.
+   */
+  std::streamsize read(char* const buf, const std::streamsize len)
+  {
+    while (true) {
+      if (const auto result = io_->read(buf, len); result >= 0)
+        return result;
+      wait_io(net::Socket_readiness::read_ready);
+    }
+  }
+
+  /**
+   * @brief Writes the `count` buffers pointed by `iov` to the descriptor.
+   *
+   * @details If the descriptor is non-blocking, the data which cannot be
+   * written immediately is queued into the output backlog. If the size of
+   * the backlog exceeds the limit, waits until the descriptor becomes
+   * writable and the backlog shrinks below the limit (backpressure).
+   *
+   * @param is_zerocopy Denotes the zero-copy write. (See
+   * `net::Descriptor::writev_zerocopy()`.)
+   *
+   * @par Effects
+   * The buffers pointed by `iov` are consumed (i.e. modified).
+   */
+  void write(net::Iovec* iov, std::size_t count, const bool is_zerocopy = false)
+  {
+    const std::lock_guard lg{io_mutex_};
+    if (output_backlog_.is_empty() || output_backlog_.drain(*io_)) {
+      while (true) {
+        // Skipping the empty buffers.
+        while (count && !iov->iov_len) {
+          ++iov;
+          --count;
+        }
+        if (!count)
+          return;
+
+        auto written = static_cast<std::size_t>(is_zerocopy ?
+          io_->writev_zerocopy(iov, count) : io_->writev(iov, count));
+        if (!written)
+          break; // would block
+
+        // Consuming the written buffers.
+        while (written) {
+          const auto n = std::min(written, iov->iov_len);
+          iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+          iov->iov_len -= n;
+          written -= n;
+          if (!iov->iov_len) {
+            ++iov;
+            --count;
+          }
+        }
+      }
+    }
+
+    output_backlog_.push(iov, count);
+    while (output_backlog_.size() > output_backlog_limit_)
+      wait_io(net::Socket_readiness::unready);
+  }
+
+  /// @overload
+  void write(const char* const buf, const std::size_t len)
+  {
+    auto iov = net::make_iovec(buf, len);
+    write(&iov, 1);
+  }
+
+  /**
+   * @brief Writes the `head` followed by `size` bytes read from `in`.
+   *
+   * @details On Linux, the bytes are moved by `splice()` through a pipe, i.e.
+   * without copying them to the user space (`SIGPIPE` is blocked meanwhile).
+   * Otherwise, they are copied by chunks. The output backlog is drained
+   * before.
+   *
+   * @par Requires
+   * `head_size <= 8`.
+   */
+  void write_relayed(const char* const head, const std::size_t head_size,
+    net::Descriptor& in, std::size_t size)
+  {
+    DMITIGR_ASSERT(head_size <= 8);
+    const std::lock_guard lg{io_mutex_};
+    flush_output_backlog();
+#ifdef __linux__
+    /*
+     * The pipe is reused by the relays of the thread. Upon failure, the data
+     * left in the pipe must never be relayed to another connection, so the
+     * pipe is dropped then.
+     */
+    thread_local std::unique_ptr<Splice_pipe> pipe;
+    if (!pipe)
+      pipe = std::make_unique<Splice_pipe>();
+    try {
+      const Sigpipe_guard sigpipe_guard;
+      if (head_size && ::write(pipe->write_end(), head, head_size) !=
+        static_cast<ssize_t>(head_size))
+        throw os::Sys_exception{"cannot write to pipe"};
+      const auto in_fd = static_cast<int>(in.native_handle());
+      const auto out_fd = static_cast<int>(io_->native_handle());
+      std::size_t pending{head_size}; // in the pipe
+      while (size || pending) {
+        if (size && pending < pipe->capacity()) {
+          const auto count = ::splice(in_fd, nullptr, pipe->write_end(),
+            nullptr, std::min(size, pipe->capacity() - pending), SPLICE_F_MOVE);
+          if (count < 0)
+            throw os::Sys_exception{"cannot splice from descriptor"};
+          else if (!count)
+            throw Exception{"cannot relay data from closed descriptor"};
+          size -= static_cast<std::size_t>(count);
+          pending += static_cast<std::size_t>(count);
+        }
+        const auto count = ::splice(pipe->read_end(), nullptr, out_fd, nullptr,
+          pending, SPLICE_F_MOVE | (size ? SPLICE_F_MORE : 0));
+        if (count < 0) {
+          if (errno != EAGAIN)
+            throw os::Sys_exception{"cannot splice to descriptor"};
+          wait_io(net::Socket_readiness::write_ready);
+        } else
+          pending -= static_cast<std::size_t>(count);
+      }
+    } catch (...) {
+      pipe.reset();
+      throw;
+    }
+#else
+    std::array<char, 16384> buffer;
+    std::copy(head, head + head_size, buffer.data());
+    std::size_t buffered{head_size};
+    while (size || buffered) {
+      const auto count = std::min(size, buffer.size() - buffered);
+      if (count) {
+        const auto n = in.read(buffer.data() + buffered,
+          static_cast<std::streamsize>(count));
+        if (n <= 0)
+          throw Exception{"cannot relay data from closed descriptor"};
+        size -= static_cast<std::size_t>(n);
+        buffered += static_cast<std::size_t>(n);
+      }
+      write(buffer.data(), buffered);
+      buffered = 0;
+    }
+#endif
+  }
+
+  /**
+   * @returns `true` if a record of the given `size` should be written with
+   * zero-copy.
+   */
+  bool is_zerocopy_worth(const std::size_t size) const noexcept
+  {
+    return zerocopy_threshold_ && *zerocopy_threshold_ <= size &&
+      io_->is_zerocopy_enabled();
+  }
+
+  /**
+   * @brief Waits until the output backlog is written to the descriptor.
+   *
+   * @par Effects
+   * The output backlog is empty.
+   */
+  void flush_output_backlog()
+  {
+    const std::lock_guard lg{io_mutex_};
+    while (!output_backlog_.drain(*io_))
+      wait_io(net::Socket_readiness::unready);
+  }
+
 private:
   friend server_Istream;
   friend server_Streambuf;
 
+  Admission_ticket admission_ticket_; // released last
   bool is_keep_connection_{};
   Role role_{};
   int request_id_{};
   int application_status_{};
   std::unique_ptr<net::Descriptor> io_;
   detail::Names_values parameters_;
+  Output_backlog output_backlog_;
+  std::size_t output_backlog_limit_{};
+  std::optional<std::size_t> zerocopy_threshold_;
+  std::size_t max_concurrent_request_count_{};
+  std::shared_ptr<Flush_timer> flush_timer_;
+  std::recursive_mutex io_mutex_; // serializes the output of the streams
+  std::atomic_bool is_aborted_{};
+  std::mutex abort_mutex_;
+  Abort_handler abort_handler_;
+
+  /**
+   * @brief Waits until the descriptor becomes ready according to `mask`, or
+   * writable if the output backlog is not empty, draining the latter.
+   */
+  void wait_io(net::Socket_readiness mask)
+  {
+    using Sr = net::Socket_readiness;
+    if (!output_backlog_.is_empty())
+      mask |= Sr::write_ready;
+    DMITIGR_ASSERT(mask != Sr::unready);
+    const auto socket = static_cast<net::Socket_native>(io_->native_handle());
+    const auto ready = net::poll(socket, mask, std::chrono::milliseconds{-1});
+    if (bool(ready & Sr::write_ready)) {
+      const std::lock_guard lg{io_mutex_};
+      output_backlog_.drain(*io_);
+    }
+  }
 };
 
 } // namespace dmitigr::fcgi::detail
@@ -19,11 +19,19 @@
 
 #include "connection.hpp"
 
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+
 namespace dmitigr::fcgi {
 
 /// A FastCGI server connection.
 class Server_connection : public Connection {
 public:
+  /// The handler of the abort of request.
+  using Abort_handler = std::function<void()>;
+
   /// @returns The input stream, associated with the input data stream.
   virtual Istream& in() noexcept = 0;
 
@@ -49,6 +57,141 @@ public:
    */
   virtual void set_application_status(int status) = 0;
 
+  /**
+   * @returns The policy of automatic flushing of the output streams. By
+   * default it's the policy of Listener_options.
+   *
+   * @see set_flush_policy().
+   */
+  virtual const Flush_policy& flush_policy() const noexcept = 0;
+
+  /**
+   * @brief Sets the policy of automatic flushing of the output streams.
+   *
+   * @details The output pending in the streams is sent before the policy is
+   * applied.
+   *
+   * @see flush_policy().
+   */
+  virtual void set_flush_policy(const Flush_policy& policy) = 0;
+
+  /**
+   * @brief Reads the whole request body from `in()`.
+   *
+   * @details If the parameter `CONTENT_LENGTH` is present, the memory for the
+   * body is allocated in advance (if `max_size` is not specified, at most 1 MiB
+   * is allocated in advance, and the rest as the body arrives), and the body
+   * is read in bulk straight into the result.
+   *
+   * @param max_size The maximum size of the body.
+   *
+   * @returns The request body.
+   *
+   * @throws Exception if the size of the body (either specified by the
+   * `CONTENT_LENGTH` or actual) exceeds `max_size`. In the former case the
+   * body is not read at all.
+   *
+   * @par Effects
+   * `in().eof()`.
+   */
+  virtual std::string read_body(std::optional<std::size_t> max_size = {}) = 0;
+
+  /**
+   * @brief Reads the whole data file input of the request of Role::filter.
+   *
+   * @details The unread rest of the request body (if any) is discarded, and
+   * the data file input is read from `in()`. If the parameter
+   * `FCGI_DATA_LENGTH` is present, the memory for the data is allocated in
+   * advance (as by read_body()), and the data is read in bulk straight into
+   * the result, so the content of the records beyond the buffer of `in()` is
+   * never copied.
+   *
+   * @param max_size The maximum size of the data.
+   *
+   * @returns The data file input.
+   *
+   * @throws Exception if the size of the data (either specified by the
+   * `FCGI_DATA_LENGTH` or actual) exceeds `max_size`. In the former case the
+   * data is not read at all.
+   *
+   * @par Requires
+   * `role() == Role::filter`.
+   *
+   * @par Effects
+   * `in().eof() && in().stream_type() == Stream_type::data`.
+   */
+  virtual std::string read_data(std::optional<std::size_t> max_size = {}) = 0;
+
+  /**
+   * @overload
+   *
+   * @details The data is appended to the `spool`, which is prepared by
+   * `spool.reserve()` for the size specified by `FCGI_DATA_LENGTH` (if
+   * `max_size` is not specified, for at most 1 MiB). Thus, the data which is
+   * known to exceed the memory limit of the spool is written to the file
+   * right away. The spooled data is available as a whole by `spool.view()`.
+   */
+  virtual void read_data(Body_spool& spool,
+    std::optional<std::size_t> max_size = {}) = 0;
+
+  /**
+   * @brief Sends the `response` as the whole content of `out()`.
+   *
+   * @details The error stream is closed before sending. The records of the
+   * `response` are sent by a single write with the patched request ID and
+   * application status.
+   *
+   * @throws Exception if something has already been written to `out()`.
+   *
+   * @par Requires
+   * `!out().is_closed()`.
+   *
+   * @par Effects
+   * `err().is_closed() && out().is_closed()`.
+   */
+  virtual void send(const Prepared_response& response) = 0;
+
+  /**
+   * @returns `true` if the request is aborted by the client, i.e. if either
+   * the abort-request record is received, or the connection is closed by the
+   * client.
+   *
+   * @details Once the request is aborted, the output to `out()` and `err()` is
+   * discarded, and only the end-request record is sent upon closing.
+   *
+   * @remarks No I/O is performed, so this function can be used as the
+   * cancellation token by any thread.
+   *
+   * @see poll_abort(), set_abort_handler().
+   */
+  virtual bool is_aborted() const noexcept = 0;
+
+  /**
+   * @brief Checks the connection for the abort of the request without
+   * blocking.
+   *
+   * @details The records received after the end of the input stream are
+   * processed. (While `in()` is being read, the abort-request record is
+   * processed anyway.)
+   *
+   * @returns `is_aborted()`.
+   *
+   * @remarks The abort of the request is not detected until `in()` is read to
+   * the end.
+   */
+  virtual bool poll_abort() = 0;
+
+  /**
+   * @brief Sets the `handler` to be called once the request is aborted.
+   *
+   * @details The handler is called by the thread which detects the abort
+   * (upon reading `in()` or by `poll_abort()`), or immediately if the request
+   * is already aborted.
+   *
+   * @see is_aborted().
+   */
+  virtual void set_abort_handler(Abort_handler handler) = 0;
+
 private:
   friend detail::iServer_connection;
 
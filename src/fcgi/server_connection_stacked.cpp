@@ -16,14 +16,24 @@
 
 #include "../base/assert.hpp"
 #include "basics.hpp"
+#include "body_spool.hpp"
 #include "exceptions.hpp"
+#include "flush_policy.hpp"
+#include "listener_options.hpp"
+#include "prepared_response.hpp"
 #include "server_connection.hpp"
 #include "streams.hpp"
 
+#include <algorithm>
 #include <array>
+#include <charconv>
 #include <cstdio>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 
 namespace dmitigr::fcgi::detail {
 
@@ -39,6 +49,12 @@ public:
   /// The size of the buffer of Stream_type::err.
   static constexpr std::size_t err_buffer_size = 65528;
 
+  /**
+   * The maximum size of the memory allocated in advance for the content of
+   * the declared length if the maximum size of the content is not specified.
+   */
+  static constexpr std::size_t max_unbounded_preallocation_size = 1048576;
+
   ~stack_buffers_Server_connection() override
   {
     try {
@@ -65,8 +81,12 @@ public:
   explicit stack_buffers_Server_connection(std::unique_ptr<net::Descriptor> io,
     const Role role,
     const int request_id,
-    const bool is_keep_connection)
-    : iServer_connection{std::move(io), role, request_id, is_keep_connection}
+    const bool is_keep_connection,
+    const Listener_options& options,
+    std::shared_ptr<Flush_timer> flush_timer,
+    Admission_ticket admission_ticket)
+    : iServer_connection{std::move(io), role, request_id, is_keep_connection,
+      options, std::move(flush_timer), std::move(admission_ticket)}
     , in_{this, in_buffer_.data(),
       static_cast<std::streamsize>(in_buffer_.size())}
     , out_{this, out_buffer_.data(),
@@ -77,6 +97,7 @@ public:
     static_assert(in_buffer_size <= std::numeric_limits<std::streamsize>::max());
     static_assert(out_buffer_size <= std::numeric_limits<std::streamsize>::max());
     static_assert(err_buffer_size <= std::numeric_limits<std::streamsize>::max());
+    set_flush_policy(options.flush_policy());
   }
 
   // ---------------------------------------------------------------------------
@@ -88,6 +109,7 @@ public:
     // Attention: the order is important!
     err().streambuf().close();
     out().streambuf().close();
+    flush_output_backlog();
     in().streambuf().close();
   }
 
@@ -130,6 +152,65 @@ public:
     return err_;
   }
 
+  const Flush_policy& flush_policy() const noexcept override
+  {
+    return flush_policy_;
+  }
+
+  void set_flush_policy(const Flush_policy& policy) override
+  {
+    for (auto* const stream : {&out_, &err_}) {
+      if (!stream->is_closed())
+        static_cast<server_Streambuf&>(stream->streambuf()).set_flush_policy(policy);
+    }
+    flush_policy_ = policy;
+  }
+
+  std::string read_body(const std::optional<std::size_t> max_size) override
+  {
+    return read_all("CONTENT_LENGTH", max_size, "request body");
+  }
+
+  std::string read_data(const std::optional<std::size_t> max_size) override
+  {
+    skip_to_data();
+    return read_all("FCGI_DATA_LENGTH", max_size, "data");
+  }
+
+  void read_data(Body_spool& spool,
+    const std::optional<std::size_t> max_size) override
+  {
+    skip_to_data();
+    const auto limit = max_size.value_or(std::numeric_limits<std::size_t>::max());
+    if (const auto length = declared_length("FCGI_DATA_LENGTH")) {
+      if (*length > limit)
+        throw Exception{"FastCGI data is too large"};
+      spool.reserve(max_size ? *length :
+        std::min(*length, max_unbounded_preallocation_size));
+    }
+    spool.append(in_, limit);
+    if (in_.bad())
+      throw Exception{"cannot read FastCGI data"};
+    in_.clear(std::ios_base::eofbit);
+  }
+
+  void send(const Prepared_response& response) override
+  {
+    if (out_.is_closed())
+      throw Exception{"cannot send prepared FastCGI response to closed stream"};
+
+    err_.streambuf().close();
+    if (is_aborted())
+      out_.streambuf().close();
+    else
+      static_cast<server_Streambuf&>(out_.streambuf()).send_prepared(response.data());
+  }
+
+  bool poll_abort() override
+  {
+    return static_cast<server_Streambuf&>(in_.streambuf()).poll_abort();
+  }
+
 private:
   std::array<server_Streambuf::char_type, in_buffer_size> in_buffer_;
   std::array<server_Streambuf::char_type, out_buffer_size> out_buffer_;
@@ -138,6 +219,102 @@ private:
   server_Istream in_;
   server_Ostream out_;
   server_Ostream err_;
+  Flush_policy flush_policy_;
+
+  /**
+   * @returns The value of the parameter `name` if it's a valid length, or
+   * `std::nullopt` otherwise.
+   */
+  std::optional<std::size_t> declared_length(const std::string_view name) const
+  {
+    if (const auto index = parameter_index(name)) {
+      const auto value = parameter(*index);
+      std::size_t result{};
+      const auto* const end = value.data() + value.size();
+      if (const auto [ptr, ec] = std::from_chars(value.data(), end, result);
+        ec == std::errc{} && ptr == end)
+        return result;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * @brief Reads the rest of `in_` preallocating the memory according to the
+   * parameter `length_name`.
+   *
+   * @param what The name of the content for error messages.
+   */
+  std::string read_all(const std::string_view length_name,
+    const std::optional<std::size_t> max_size, const std::string_view what)
+  {
+    constexpr std::size_t initial_size{16384};
+    const auto limit = max_size.value_or(std::numeric_limits<std::size_t>::max());
+    const auto too_large = [what]
+    {
+      return Exception{std::string{"FastCGI "}.append(what)
+        .append(" is too large")};
+    };
+
+    /*
+     * The declared length is supplied by the client, so unless it's bounded
+     * by the `max_size` only the part of it is allocated in advance, and the
+     * rest is allocated as the content actually arrives.
+     */
+    std::string result;
+    const auto length = declared_length(length_name);
+    if (length) {
+      if (*length > limit)
+        throw too_large();
+      result.resize(max_size ? *length :
+        std::min(*length, max_unbounded_preallocation_size));
+    }
+
+    // The content is read by server_Streambuf::xsgetn() in bulk.
+    std::size_t size{};
+    while (true) {
+      if (size == result.size()) {
+        if (Istream::traits_type::eq_int_type(in_.peek(),
+            Istream::traits_type::eof()))
+          break;
+        else if (size == limit)
+          throw too_large();
+        auto growth = std::min(limit - size, std::max(size, initial_size));
+        if (length && *length > size)
+          growth = std::min(growth, *length - size);
+        result.resize(size + growth);
+      }
+      in_.read(result.data() + size,
+        static_cast<std::streamsize>(result.size() - size));
+      size += static_cast<std::size_t>(in_.gcount());
+      if (!in_)
+        break;
+    }
+    result.resize(size);
+    if (in_.bad())
+      throw Exception{std::string{"cannot read FastCGI "}.append(what)};
+    in_.clear(std::ios_base::eofbit);
+
+    return result;
+  }
+
+  /**
+   * @brief Discards the unread rest of the request body and switches `in_`
+   * to the data file input.
+   */
+  void skip_to_data()
+  {
+    if (role() != Role::filter)
+      throw Exception{"cannot read FastCGI data of request of non-filter role"};
+
+    // The stream is switched to the data upon the end of the request body.
+    if (in_.stream_type() == Stream_type::in) {
+      in_.ignore(std::numeric_limits<std::streamsize>::max());
+      if (in_.bad())
+        throw Exception{"cannot read FastCGI request body"};
+    }
+    DMITIGR_ASSERT(in_.stream_type() == Stream_type::data);
+    in_.clear();
+  }
 };
 
 } // namespace dmitigr::fcgi::detail
@@ -16,15 +16,30 @@
 
 #include "basics.hpp"
 #include "exceptions.hpp"
+#include "flush_policy.hpp"
 #include "server_connection.hpp"
 #include "streambuf.hpp"
 #include "../base/assert.hpp"
 #include "../math/alignment.hpp"
+#include "../net/descriptor.hpp"
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 /*
  * By defining DMITIGR_FCGI_DEBUG some convenient stuff for debugging
@@ -37,6 +52,93 @@
 
 namespace dmitigr::fcgi::detail {
 
+/**
+ * @brief The timer to enforce the time threshold of the flush policy.
+ *
+ * @details The timer thread is started upon the first registration of the
+ * stream buffer and periodically flushes the output of the registered stream
+ * buffers which is pending longer than the time threshold.
+ */
+class Flush_timer final {
+public:
+  /// The destructor.
+  ~Flush_timer()
+  {
+    stop();
+  }
+
+  /// The default constructor.
+  Flush_timer() = default;
+
+  Flush_timer(const Flush_timer&) = delete;
+  Flush_timer& operator=(const Flush_timer&) = delete;
+  Flush_timer(Flush_timer&&) = delete;
+  Flush_timer& operator=(Flush_timer&&) = delete;
+
+  /**
+   * @brief Registers the `streambuf` to flush its output pending longer
+   * than `threshold`.
+   *
+   * @remarks Has no effect if the timer is stopped.
+   */
+  void add(server_Streambuf* const streambuf,
+    const std::chrono::milliseconds threshold)
+  {
+    DMITIGR_ASSERT(streambuf && threshold.count() > 0);
+    const std::lock_guard lg{mutex_};
+    if (is_stopped_)
+      return;
+
+    streambufs_.emplace_back(streambuf, threshold);
+    if (!thread_.joinable())
+      thread_ = std::thread{&Flush_timer::run, this};
+    condition_.notify_one();
+  }
+
+  /**
+   * @brief Unregisters the `streambuf`.
+   *
+   * @details If the `streambuf` is being flushed by the timer at the moment,
+   * waits for the completion of its flush. (The flushes of other instances
+   * are never awaited.)
+   *
+   * @par Effects
+   * The `streambuf` is not accessed by the timer after return.
+   */
+  void remove(const server_Streambuf* const streambuf)
+  {
+    std::unique_lock lk{mutex_};
+    streambufs_.erase(std::remove_if(streambufs_.begin(), streambufs_.end(),
+        [streambuf](const auto& e){return e.first == streambuf;}),
+      streambufs_.end());
+    flushed_.wait(lk, [this, streambuf]{return flushing_ != streambuf;});
+  }
+
+  /// Stops the timer thread.
+  void stop()
+  {
+    {
+      const std::lock_guard lg{mutex_};
+      is_stopped_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+private:
+  bool is_stopped_{};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::condition_variable flushed_;
+  std::thread thread_;
+  std::vector<std::pair<server_Streambuf*, std::chrono::milliseconds>> streambufs_;
+  const server_Streambuf* flushing_{}; // flushed without the mutex_ held
+
+  /// The timer loop.
+  void run();
+};
+
 /**
  * @brief The base implementation of Streambuf.
  */
@@ -103,12 +205,16 @@ public:
       return;
 
     if (!is_reader()) {
+      remove_from_flush_timer();
+
       const auto& inbuf = dynamic_cast<server_Streambuf&>(
         connection_->in().streambuf());
       DMITIGR_ASSERT(inbuf.is_reader() && !inbuf.is_closed());
       const auto role = connection_->role();
       DMITIGR_ASSERT(role == Role::authorizer || inbuf.type_ != Type::params);
-      if (role != Role::filter ||
+      if (is_end_of_stream_) {
+        // The end records are already sent (or failed to) by the prior close.
+      } else if (role != Role::filter ||
         inbuf.type_ == Type::data || inbuf.unread_content_length_ == 0) {
         is_end_records_must_be_transmitted_ = true;
         sync();
@@ -116,6 +222,10 @@ public:
         throw Exception{"not all FastCGI stdin has been read by Filter"};
 
       DMITIGR_ASSERT(is_end_of_stream_ && !is_end_records_must_be_transmitted_);
+
+      // The buffers must not be released until the kernel is done with them.
+      auto& io = *connection_->io_;
+      io.wait_zerocopy(io.zerocopy_write_count());
     }
 
     setg(nullptr, nullptr, nullptr);
@@ -159,6 +269,258 @@ public:
     return type_;
   }
 
+  /**
+   * @brief Sets the flush policy of the output stream.
+   *
+   * @details The pending output (if any) is sent before the policy is applied.
+   * The flush after the header block takes effect only if nothing has been
+   * written to the stream of type Stream_type::out yet.
+   *
+   * @par Requires
+   * `!is_reader() && !is_closed()`.
+   */
+  void set_flush_policy(const Flush_policy& policy)
+  {
+    DMITIGR_ASSERT(!is_reader() && !is_closed());
+    remove_from_flush_timer();
+
+    const std::lock_guard lg{put_mutex_};
+    const bool is_nothing_written = pptr() == pbase() &&
+      !is_put_area_at_least_once_consumed_;
+    if (pptr() != pbase() || coalesced_begin_ != coalesced_end_) {
+      open_put_area();
+      send_put_area(traits_type::eof(), false);
+    }
+
+    // The size of the put area + 1 (for overflow()) must be a multiple of 8.
+    const auto max_size = buffer_size_ - sizeof(detail::Header) - 1;
+    if (const auto threshold = policy.byte_threshold()) {
+      const auto size = static_cast<std::streamsize>(
+        std::min<std::size_t>(*threshold, buffer_size_));
+      put_area_size_ = std::min<std::streamsize>(max_size,
+        math::aligned<std::streamsize>(std::max<std::streamsize>(size, 1), 8) - 1);
+      is_byte_threshold_flush_ = true;
+    } else {
+      put_area_size_ = max_size;
+      is_byte_threshold_flush_ = false;
+    }
+    time_threshold_ = policy.time_threshold();
+    header_end_match_ = type_ == Type::out && policy.is_flush_after_headers() &&
+      is_nothing_written ? 0 : -1;
+    is_put_area_guarded_ = time_threshold_ || header_end_match_ >= 0;
+    if (const auto limit = policy.coalescing_limit()) {
+      coalescing_limit_ = static_cast<std::streamsize>(
+        std::min<std::size_t>(*limit, buffer_size_ / 2));
+      coalescing_interval_ = policy.coalescing_interval();
+    } else {
+      coalescing_limit_.reset();
+      coalescing_interval_.reset();
+    }
+    reset_put_area();
+
+    if (connection_->flush_timer_) {
+      std::optional<std::chrono::milliseconds> threshold;
+      for (const auto& t : {time_threshold_, coalescing_interval_}) {
+        if (t)
+          threshold = threshold ? std::min(*threshold, *t) : *t;
+      }
+      if (threshold) {
+        connection_->flush_timer_->add(this, *threshold);
+        is_added_to_flush_timer_ = true;
+      }
+    }
+
+    DMITIGR_ASSERT(is_invariant_ok());
+  }
+
+  /**
+   * @returns `true` if the put area is guarded, i.e. if the writes are
+   * serialized and performed by xsputn() and overflow() only.
+   */
+  bool is_put_area_guarded() const noexcept
+  {
+    return is_put_area_guarded_;
+  }
+
+  /**
+   * @brief Flushes the output pending longer than the time threshold, or
+   * the coalesced records held longer than the coalescing interval.
+   *
+   * @details Does nothing if the stream is busy at the moment.
+   *
+   * @remarks Called by Flush_timer.
+   */
+  void flush_expired(const std::chrono::steady_clock::time_point now)
+  {
+    std::unique_lock lk{put_mutex_, std::try_to_lock};
+    if (!lk || is_end_of_stream_)
+      return;
+
+    if (pending_since_ && time_threshold_ &&
+      now - *pending_since_ >= *time_threshold_) {
+      DMITIGR_ASSERT(is_put_area_guarded_);
+      open_put_area();
+      send_put_area(traits_type::eof(), true);
+      close_put_area();
+    } else if (coalesced_since_ && coalescing_interval_ &&
+      now - *coalesced_since_ >= *coalescing_interval_)
+      send_coalesced();
+  }
+
+  /**
+   * @brief Processes the records which are received after the end of the
+   * input stream without blocking.
+   *
+   * @returns `true` if the request is aborted.
+   *
+   * @par Requires
+   * `is_reader()`.
+   */
+  bool poll_abort()
+  {
+    DMITIGR_ASSERT(is_reader());
+    if (is_closed() || !is_end_of_stream_ || connection_->is_aborted())
+      return connection_->is_aborted();
+
+    is_end_of_stream_ = false;
+    is_polling_ = true;
+    try {
+      while (!connection_->is_aborted() &&
+        !traits_type::eq_int_type(underflow(), traits_type::eof()))
+        setg(egptr(), egptr(), egptr()); // Discarding the unexpected content.
+    } catch (...) {
+      is_polling_ = false;
+      is_end_of_stream_ = true;
+      throw;
+    }
+    is_polling_ = false;
+    is_end_of_stream_ = true;
+    setg(gptr(), gptr(), gptr());
+    return connection_->is_aborted();
+  }
+
+  /**
+   * @brief Sends the pending output (if any) and closes the stream without
+   * sending the end records. The records of the stream and the end records
+   * become the responsibility of the caller.
+   *
+   * @par Requires
+   * `!is_reader() && !is_closed()`.
+   *
+   * @par Effects
+   * `is_closed()`.
+   */
+  void hand_over()
+  {
+    DMITIGR_ASSERT(!is_reader() && !is_closed());
+    remove_from_flush_timer();
+
+    const std::lock_guard lg{put_mutex_};
+    if (pptr() != pbase() || coalesced_begin_ != coalesced_end_) {
+      open_put_area();
+      send_put_area(traits_type::eof(), true);
+    }
+    is_end_of_stream_ = true;
+
+    // The buffers must not be released until the kernel is done with them.
+    auto& io = *connection_->io_;
+    io.wait_zerocopy(io.zerocopy_write_count());
+
+    setg(nullptr, nullptr, nullptr);
+    setp(nullptr, nullptr);
+    DMITIGR_ASSERT(is_closed());
+  }
+
+  /**
+   * @brief Sends the prepared `records` (see Prepared_response) as the content
+   * of the stream followed by the end records, and closes the stream.
+   *
+   * @details The `records` are sent as is if the request ID is `1` and the
+   * application status is `0`. Otherwise, the patched copies of the headers
+   * are sent instead of the original ones, and the content is still sent
+   * from the `records`.
+   *
+   * @par Requires
+   * `type_ == Type::out && !is_closed()` and nothing is written to the stream.
+   *
+   * @par Effects
+   * `is_closed()`.
+   */
+  void send_prepared(const std::string_view records)
+  {
+    DMITIGR_ASSERT(type_ == Type::out && !is_closed());
+    DMITIGR_ASSERT(records.size() >=
+      sizeof(detail::Header) + sizeof(detail::End_request_record));
+    remove_from_flush_timer();
+
+    const std::lock_guard lg{put_mutex_};
+    if (pptr() != pbase() || is_put_area_at_least_once_consumed_ ||
+      coalesced_begin_ != coalesced_end_)
+      throw Exception{"cannot send prepared FastCGI response after writing"
+        " to the output stream"};
+
+    const auto& inbuf = dynamic_cast<server_Streambuf&>(
+      connection_->in().streambuf());
+    if (connection_->role() == Role::filter && inbuf.type_ != Type::data &&
+      inbuf.unread_content_length_ != 0)
+      throw Exception{"not all FastCGI stdin has been read by Filter"};
+
+    const int request_id = connection_->request_id();
+    const int application_status = connection_->application_status();
+    {
+      const std::lock_guard lg{connection_->io_mutex_};
+      if (request_id == 1 && application_status == 0)
+        connection_->write(records.data(), records.size());
+      else {
+        auto* const end_header = reinterpret_cast<detail::Header*>(
+          end_records_.data());
+        *end_header = detail::Header{detail::Record_type::out, request_id, 0, 0};
+        *reinterpret_cast<detail::End_request_record*>(end_records_.data() +
+          sizeof(detail::Header)) = detail::End_request_record{request_id,
+            application_status, detail::Protocol_status::request_complete};
+
+        /*
+         * The content records are sent by batches of the patched headers
+         * followed by the content (with padding) from the `records`. The end
+         * records are sent along with the last batch.
+         */
+        constexpr std::size_t batch_size{64};
+        static_assert(2*batch_size + 1 <= net::max_iov_count);
+        std::array<detail::Header, batch_size> headers;
+        std::array<net::Iovec, 2*batch_size + 1> iov;
+        const char* record{records.data()};
+        const char* const records_end{records.data() + records.size() -
+          sizeof(detail::Header) - sizeof(detail::End_request_record)};
+        do {
+          std::size_t iov_count{};
+          for (std::size_t i{}; i < batch_size && record < records_end; ++i) {
+            std::memcpy(&headers[i], record, sizeof(headers[i]));
+            const auto content_length = headers[i].content_length();
+            const auto padding_length = headers[i].padding_length();
+            headers[i] = detail::Header{detail::Record_type::out, request_id,
+              content_length, padding_length};
+            iov[iov_count++] = net::make_iovec(&headers[i], sizeof(headers[i]));
+            iov[iov_count++] = net::make_iovec(record + sizeof(detail::Header),
+              content_length + padding_length);
+            record += sizeof(detail::Header) + content_length + padding_length;
+          }
+          DMITIGR_ASSERT(record <= records_end);
+          if (record == records_end)
+            iov[iov_count++] = net::make_iovec(end_records_.data(),
+              end_records_.size());
+          connection_->write(iov.data(), iov_count);
+        } while (record < records_end);
+      }
+      connection_->io_->uncork();
+    }
+    is_put_area_at_least_once_consumed_ = true;
+    is_end_of_stream_ = true;
+
+    setg(nullptr, nullptr, nullptr);
+    setp(nullptr, nullptr);
+    DMITIGR_ASSERT(is_closed());
+  }
+
 protected:
 
   // std::streambuf overridings:
@@ -175,6 +537,11 @@ protected:
     constexpr std::streamsize alignment = 8;
     buffer_ = buffer;
     buffer_size_ = size - (alignment - math::padding(size, alignment)) % alignment;
+    put_buffers_ = {};
+    put_buffers_[0].data = buffer_;
+    put_buffers_storage_.reset();
+    put_buffer_index_ = 0;
+    put_area_size_ = buffer_size_ - sizeof(detail::Header) - 1;
 
     if (is_reader()) {
       setg(buffer_, buffer_, buffer_);
@@ -187,7 +554,7 @@ protected:
        * epptr() can be used to store this byte.
        */
       setg(nullptr, nullptr, nullptr);
-      setp(buffer_ + sizeof(detail::Header), buffer_ + buffer_size_ - 1);
+      reset_put_area();
     }
 
     DMITIGR_ASSERT(is_invariant_ok());
@@ -213,10 +580,20 @@ protected:
     while (true) {
       // Reading the stream records.
       if (gptr() == buffer_end_) {
-        const std::streamsize count = connection_->io_->read(buffer_, buffer_size_);
+        // Upon polling, only the records which are already received are read.
+        const bool is_record_boundary = !read_header_length &&
+          !unread_content_length_ && !unread_padding_length_;
+        if (is_polling_ && is_record_boundary && !connection_->is_readable())
+          return traits_type::eof();
+
+        const std::streamsize count = connection_->read(buffer_, buffer_size_);
         if (count > 0) {
           buffer_end_ = buffer_ + count;
           setg(buffer_, buffer_, buffer_end_);
+        } else if (is_polling_ && is_record_boundary) {
+          // The connection is closed by the client.
+          connection_->abort();
+          return traits_type::eof();
         } else
           throw Exception{"FastCGI protocol violation"};
       }
@@ -260,6 +637,30 @@ protected:
       // The start point
       // ---------------
 
+      /*
+       * The fast path: the header and the whole content of the expected stream
+       * record are in the buffer, so the header is decoded in place and the
+       * get area is set up for the content right away. (The padding is skipped
+       * upon the next call.)
+       */
+      if (!read_header_length &&
+        buffer_end_ - gptr() >= static_cast<std::streamsize>(sizeof(header))) {
+        const auto& h = *reinterpret_cast<const detail::Header*>(gptr());
+        const auto content_length = static_cast<std::streamsize>(
+          h.content_length());
+        if (h.protocol_version() == 1 && content_length > 0 &&
+          h.record_type() == static_cast<detail::Record_type>(type_) &&
+          h.request_id() == connection_->request_id() &&
+          static_cast<std::streamsize>(sizeof(h)) + content_length <=
+          buffer_end_ - gptr()) {
+          unread_padding_length_ = static_cast<std::streamsize>(
+            h.padding_length());
+          auto* const content = gptr() + sizeof(h);
+          setg(content, content, content + content_length);
+          return traits_type::to_int_type(*gptr());
+        }
+      }
+
       // Accumulating the header.
       {
         const std::size_t count = std::min(sizeof(header) - read_header_length,
@@ -273,6 +674,7 @@ protected:
       }
 
       DMITIGR_ASSERT(read_header_length == sizeof(header));
+      read_header_length = 0; // the next record may follow
 
       // Processing the header.
       {
@@ -311,64 +713,170 @@ protected:
     }
   }
 
+  std::streamsize xsgetn(char_type* const s, const std::streamsize count) override
+  {
+    DMITIGR_ASSERT(is_reader() && !is_closed());
+
+    std::streamsize result{};
+    while (result < count) {
+      if (gptr() == egptr()) {
+        if (gptr() == buffer_end_ && unread_content_length_ > 0 &&
+          !is_content_must_be_discarded_) {
+          /*
+           * All the data read is consumed and the content of the current
+           * record follows, so it's read straight into `s`, bypassing the
+           * buffer.
+           */
+          const auto length = connection_->read(s + result,
+            std::min(count - result, unread_content_length_));
+          if (length <= 0)
+            throw Exception{"FastCGI protocol violation"};
+          unread_content_length_ -= length;
+          result += length;
+          continue;
+        } else if (traits_type::eq_int_type(underflow(), traits_type::eof()))
+          break;
+      }
+
+      const auto length = std::min(count - result, egptr() - gptr());
+      std::memcpy(s + result, gptr(), static_cast<std::size_t>(length));
+      gbump(static_cast<int>(length));
+      result += length;
+    }
+
+    DMITIGR_ASSERT(is_invariant_ok());
+
+    return result;
+  }
+
   int_type overflow(const int_type ch) override
   {
     DMITIGR_ASSERT(!is_reader() && !is_closed());
 
+    const bool is_eof = traits_type::eq_int_type(ch, traits_type::eof());
+    const bool is_coalescing = is_eof && coalescing_limit_ &&
+      !is_end_records_must_be_transmitted_;
+    if (!is_put_area_guarded_) {
+      if (!coalescing_limit_)
+        return send_put_area(ch, is_eof || is_byte_threshold_flush_);
+
+      // The flush timer can send the coalesced records concurrently.
+      const std::lock_guard lg{put_mutex_};
+      return is_coalescing ? coalesce_put_area() :
+        send_put_area(ch, is_eof || is_byte_threshold_flush_);
+    }
+
+    const std::lock_guard lg{put_mutex_};
+    if (is_eof) {
+      open_put_area();
+      const auto result = is_coalescing ? coalesce_put_area() :
+        send_put_area(ch, true);
+      close_put_area();
+      return result;
+    } else {
+      const auto c = traits_type::to_char_type(ch);
+      return write_guarded(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+  }
+
+  std::streamsize xsputn(const char_type* const s,
+    const std::streamsize count) override
+  {
+    DMITIGR_ASSERT(!is_reader() && !is_closed());
+
+    if (!is_put_area_guarded_)
+      return iStreambuf::xsputn(s, count);
+
+    const std::lock_guard lg{put_mutex_};
+    return write_guarded(s, count);
+  }
+
+private:
+  friend Deflate_streambuf;
+  friend Flush_timer;
+  friend server_Istream;
+  friend Writer;
+
+  /**
+   * @brief Flushes the put area if `size` bytes don't fit in its free space
+   * but fit in the empty put area, so they can be placed there at once.
+   *
+   * @returns `false` on failure.
+   *
+   * @par Requires
+   * `!is_reader() && !is_closed()`.
+   */
+  bool make_room(const std::streamsize size)
+  {
+    DMITIGR_ASSERT(!is_reader() && !is_closed());
+    {
+      // The flush timer can send the put area concurrently.
+      std::unique_lock lk{put_mutex_, std::defer_lock};
+      if (is_put_area_guarded_ || coalescing_limit_)
+        lk.lock();
+      const auto used = pptr() - pbase();
+      if (!used || put_area_capacity() - used >= size || size > put_area_size_)
+        return true;
+    }
+    return !traits_type::eq_int_type(overflow(traits_type::eof()),
+      traits_type::eof());
+  }
+
+  /**
+   * @brief Sends the coalesced records (if any) and the content of the put
+   * area followed by `ch` (unless it's EOF) as the record. Sends the end
+   * records if they must be transmitted.
+   *
+   * @param is_flush Denotes the explicit flush. Otherwise, the transmission
+   * can be deferred according to the output policy of the descriptor.
+   *
+   * @returns EOF on failure.
+   */
+  int_type send_put_area(const int_type ch, const bool is_flush)
+  {
+    DMITIGR_ASSERT(!is_reader() && !is_closed());
+
     if (is_end_of_stream_)
       return traits_type::eof();
 
     const bool is_eof = traits_type::eq_int_type(ch, traits_type::eof());
 
-    DMITIGR_ASSERT(pbase() == (buffer_ + sizeof(detail::Header)));
-    if (std::streamsize content_length = pptr() - pbase()) {
-      /*
-       * If `ch` is not EOF we need to place `ch` at the location pointed to by
-       * pptr(). (It's ok if pptr() == epptr() since that location is a valid
-       * writable location reserved for extra `ch`.)
-       * The content should be aligned by padding if necessary, and the record
-       * header must be injected at the reserved space [buffer_, pbase()).
-       * After that the result record will be ready to send to a client.
-       */
-
-      // Store `ch` if it's not EOF.
-      if (!is_eof) {
-        DMITIGR_ASSERT(pptr() <= epptr());
-        *pptr() = static_cast<char>(ch);
-        pbump(1); // Yes, pptr() > epptr() is possible here, but this is ok.
-        content_length++;
-      }
-
-      // Aligning the content by padding if necessary.
-      const auto padding_length =
-        dmitigr::math::padding<std::streamsize>(content_length, 8);
-      DMITIGR_ASSERT(padding_length <= epptr() - pptr() + 1);
-      std::memset(pptr(), 0, static_cast<std::size_t>(padding_length));
-      pbump(static_cast<int>(padding_length));
-
-      // Injecting the header.
-      auto* const header = reinterpret_cast<detail::Header*>(buffer_);
-      *header = detail::Header{static_cast<detail::Record_type>(type_),
-        connection_->request_id(),
-        static_cast<std::size_t>(content_length),
-        static_cast<std::size_t>(padding_length)};
-
-      // Sending the record.
-      if (const auto record_size = pptr() - buffer_;
-        static_cast<std::size_t>(record_size) > sizeof(detail::Header)) {
-        const std::streamsize count = connection_->io_->write(static_cast<const char*>(buffer_), record_size);
-        DMITIGR_ASSERT(count == record_size);
-        is_put_area_at_least_once_consumed_ = true;
-      }
+    // The output of the aborted request is discarded.
+    if (connection_->is_aborted()) {
+      coalesced_begin_ = coalesced_end_ = 0;
+      coalesced_since_.reset();
+      reset_put_area();
+      pending_since_.reset();
+      if (!is_end_records_must_be_transmitted_)
+        return is_eof ? traits_type::not_eof(ch) : ch;
     }
-    setp(buffer_ + sizeof(detail::Header), buffer_ + buffer_size_ - 1);
 
+    // Up to the content records and the end records.
+    std::array<net::Iovec, 2> iov;
+    std::size_t iov_count{};
+
+    DMITIGR_ASSERT(pbase() == buffer_ + coalesced_end_ + sizeof(detail::Header));
+    if (pptr() != pbase())
+      finish_record(ch);
+
+    // Scheduling the coalesced records and the record (if any) for sending.
+    auto* const records = buffer_ + coalesced_begin_;
+    auto* const records_end = pptr() != pbase() ? pptr() :
+      pbase() - sizeof(detail::Header);
+    const auto record_size = static_cast<std::size_t>(records_end - records);
+    if (record_size)
+      iov[iov_count++] = net::make_iovec(records, record_size);
+
+    /*
+     * The end records are sent along with the last content record by using
+     * the vectored write, which makes small responses one system call. (The
+     * end records are stored in the member rather than on the stack, since
+     * they can be sent with zero-copy along with the content.)
+     */
+    auto& end_records = end_records_;
     if (is_end_records_must_be_transmitted_) {
-      /*
-       * We'll use buffer_ directly here. (Space before pbase() will be used.)
-       * data_size is a size of data in the buffer_ to send.
-       */
-      std::streamsize data_size{};
+      // data_size is a size of data in the end_records to send.
+      std::size_t data_size{};
 
       const auto is_empty = [this]()
       {
@@ -384,7 +892,8 @@ protected:
          * must be transmitted. (As optimization, no stderr records are
          * transmitted if the stream is empty.)
          */
-        auto* const header = reinterpret_cast<detail::Header*>(buffer_ + data_size);
+        auto* const header = reinterpret_cast<detail::Header*>(
+          end_records.data() + data_size);
         *header = detail::Header{static_cast<detail::Record_type>(type_),
           connection_->request_id(), 0, 0};
         data_size += sizeof(detail::Header);
@@ -396,7 +905,7 @@ protected:
        */
       if (type_ == Type::out) {
         auto* const record = reinterpret_cast<detail::End_request_record*>(
-          buffer_ + data_size);
+          end_records.data() + data_size);
         *record = detail::End_request_record{
           connection_->request_id(),
           connection_->application_status(),
@@ -404,24 +913,49 @@ protected:
         data_size += sizeof(detail::End_request_record);
       }
 
-      if (data_size > 0) {
-        const std::streamsize count = connection_->io_->write(
-          static_cast<const char*>(buffer_), data_size);
-        DMITIGR_ASSERT(count == data_size);
-      }
+      if (data_size > 0)
+        iov[iov_count++] = net::make_iovec(end_records.data(), data_size);
 
       is_end_records_must_be_transmitted_ = false;
       is_end_of_stream_ = true;
     }
 
+    {
+      // The flush timer and the other stream can write concurrently.
+      const std::lock_guard lg{connection_->io_mutex_};
+
+      // Sending the records.
+      if (iov_count) {
+        /*
+         * More records will follow unless this is an explicit flush or the
+         * end of stream, so the transmission can be deferred according to the
+         * output policy.
+         */
+        if (!is_flush)
+          connection_->io_->cork();
+
+        auto& io = *connection_->io_;
+        const auto zerocopy_write_count = io.zerocopy_write_count();
+        connection_->write(iov.data(), iov_count,
+          connection_->is_zerocopy_worth(record_size));
+        if (io.zerocopy_write_count() != zerocopy_write_count)
+          switch_put_buffer();
+      }
+
+      // Pushing the deferred records either on flush or at the end of request.
+      if (is_flush)
+        connection_->io_->uncork();
+    }
+    coalesced_begin_ = coalesced_end_ = 0;
+    coalesced_since_.reset();
+    reset_put_area();
+    pending_since_.reset();
+
     DMITIGR_ASSERT(is_invariant_ok());
 
     return is_eof ? traits_type::not_eof(ch) : ch;
   }
 
-private:
-  friend server_Istream;
-
   /**
    * @brief A result of process_header().
    */
@@ -436,10 +970,20 @@ private:
     content_must_be_discarded
   };
 
+  /// The put area buffer.
+  struct Put_buffer final {
+    char_type* data{};
+    std::uint64_t zerocopy_write_count{}; // to complete before reusing
+  };
+
+  /// The number of put area buffers to rotate upon zero-copy writes.
+  static constexpr std::size_t put_buffer_count{4};
+
   Type type_{};
   bool is_content_must_be_discarded_{};
   bool is_end_of_stream_{};
   bool is_end_records_must_be_transmitted_{};
+  bool is_polling_{}; // by poll_abort()
   bool is_put_area_at_least_once_consumed_{};
   char_type* buffer_{};
   char_type* buffer_end_{}; // Used by underflow() to mark the actual end of get area. (buffer_end_ <= buffer_ + buffer_size_).
@@ -447,6 +991,24 @@ private:
   std::streamsize unread_content_length_{};
   std::streamsize unread_padding_length_{};
   iServer_connection* const connection_{};
+  std::array<Put_buffer, put_buffer_count> put_buffers_{}; // [0] is passed to setbuf()
+  std::unique_ptr<char_type[]> put_buffers_storage_; // for put_buffers_[1..]
+  std::size_t put_buffer_index_{};
+  std::array<char, sizeof(detail::Header) +
+    sizeof(detail::End_request_record)> end_records_;
+  std::streamsize put_area_size_{}; // excluding the byte reserved for overflow()
+  bool is_byte_threshold_flush_{};
+  bool is_put_area_guarded_{};
+  bool is_added_to_flush_timer_{};
+  int header_end_match_{-1}; // the length of matched CRLFCRLF or -1
+  std::optional<std::chrono::milliseconds> time_threshold_;
+  std::optional<std::chrono::steady_clock::time_point> pending_since_;
+  std::optional<std::streamsize> coalescing_limit_;
+  std::optional<std::chrono::milliseconds> coalescing_interval_;
+  std::streamsize coalesced_begin_{}; // offset of the unsent coalesced records
+  std::streamsize coalesced_end_{}; // offset of the end of coalesced records
+  std::optional<std::chrono::steady_clock::time_point> coalesced_since_;
+  std::mutex put_mutex_; // used if is_put_area_guarded_ or coalescing_limit_
 
   // ===========================================================================
 
@@ -457,7 +1019,7 @@ private:
       (!is_reader() || (buffer_end_ && (buffer_end_ <= buffer_ + buffer_size_)));
     const bool buffer_size_ok = (buffer_size_ >= 2048) &&
       (buffer_size_ <= 65528) && (buffer_size_ % 8 == 0);
-    const bool unread_content_length_ok = (unread_content_length_ <= buffer_size_ &&
+    const bool unread_content_length_ok = (unread_content_length_ >= 0 &&
       unread_content_length_ <= static_cast<std::streamsize>(
         detail::Header::max_content_length));
     const bool unread_padding_length_ok = (unread_padding_length_ <= buffer_size_ &&
@@ -481,7 +1043,8 @@ private:
     const bool put_area_ok = is_reader() ||
       (is_closed() ||
         ((pbase() <= pptr() && pptr() <= epptr()) &&
-          (is_end_of_stream_ || (pbase() == buffer_ + sizeof(detail::Header)))));
+          (is_end_of_stream_ ||
+            (pbase() == buffer_ + coalesced_end_ + sizeof(detail::Header)))));
     const bool get_area_ok = !is_reader() ||
       (is_closed() ||
         (eback() <= gptr() && gptr() <= egptr() && egptr() <= buffer_end_));
@@ -516,9 +1079,9 @@ private:
    * @throws Exception in case of (1) or on protocol violation.
    *
    * @par Effects
-   * In all cases: `(unread_content_length_ == header.content_length()) &&
-   * (unread_padding_length_ == header.padding_length())`.
-   * In case (2): the effects of underflow().
+   * In all cases: `(unread_padding_length_ == header.padding_length())`.
+   * In case (2): `(unread_content_length_ == 0)`, i.e. the content is consumed.
+   * In other cases: `(unread_content_length_ == header.content_length())`.
    */
   Process_header_result process_header(const detail::Header header)
   {
@@ -531,9 +1094,7 @@ private:
     const auto end_request = [&](const detail::Protocol_status protocol_status)
     {
       const detail::End_request_record record{header.request_id(), 0, protocol_status};
-      const auto count = connection_->io_->write(
-        reinterpret_cast<const char*>(&record), sizeof(record));
-      DMITIGR_ASSERT(count == sizeof(record));
+      connection_->write(reinterpret_cast<const char*>(&record), sizeof(record));
     };
 
     // Called in cases of protocol violation.
@@ -543,76 +1104,51 @@ private:
       throw Exception{"FastCGI protocol violation"};
     };
 
+    /*
+     * Reads the content of the management record. (It's read bypassing the
+     * stream, which would otherwise continue with the records which follow.)
+     */
+    const auto read_management_content = [&]()
+    {
+      std::string result(static_cast<std::size_t>(unread_content_length_), '\0');
+      for (std::size_t offset{}; offset < result.size();) {
+        if (gptr() < buffer_end_) {
+          const auto count = std::min(buffer_end_ - gptr(),
+            static_cast<std::streamsize>(result.size() - offset));
+          std::memcpy(result.data() + offset, gptr(),
+            static_cast<std::size_t>(count));
+          gbump(static_cast<int>(count)); // Consumed.
+          offset += static_cast<std::size_t>(count);
+        } else {
+          const auto count = connection_->read(result.data() + offset,
+            static_cast<std::streamsize>(result.size() - offset));
+          if (count <= 0)
+            throw Exception{"FastCGI protocol violation"};
+          offset += static_cast<std::size_t>(count);
+        }
+      }
+      setg(gptr(), gptr(), gptr());
+      unread_content_length_ = 0;
+      return result;
+    };
+
     const auto process_management_record = [&]()
     {
-      namespace math = dmitigr::math;
+      auto content = read_management_content();
       if (header.record_type() == detail::Record_type::get_values) {
-        // The length of "FCGI_MPXS_CONNS" == 15.
-        constexpr std::size_t max_variable_name_length{15};
-        constexpr std::size_t max_body_length{3 * (sizeof(char) + sizeof(char)
-          + max_variable_name_length + sizeof(char))};
-        constexpr std::streamsize max_record_length{sizeof(detail::Header)
-          + max_body_length};
-        std::array<unsigned char,
-          math::aligned<std::size_t>(max_record_length, 8)> record;
-        static_assert((record.size() % 8 == 0));
-
         // Reading the requested variables.
-        const auto variables = [&]()
+        const auto variables = [&content]()
         {
-          std::istream stream{this};
+          std::istringstream stream{std::move(content)};
           return detail::Names_values{stream, 3};
         }();
-        if (unread_content_length_ > 0)
-          end_request_protocol_violation();
-
-        // Filling up the content of get-values-result.
-        const auto content_offset = std::begin(record) + sizeof(detail::Header);
-        auto p = content_offset;
-        const auto variables_count = variables.pair_count();
-        for (std::size_t i = 0; i < variables_count; ++i) {
-          const auto name = variables.pair(i).name();
-          char value{};
-          if (name == "FCGI_MAX_CONNS")
-            value = '1';
-          else if (name == "FCGI_MAX_REQS")
-            value = '1';
-          else if (name == "FCGI_MPXS_CONNS")
-            value = '0';
-          else
-            continue; // Ignoring other variables specified in the get-values record.
-
-          const auto name_size = name.size();
-          if (name_size > std::numeric_limits<unsigned char>::max())
-            end_request_protocol_violation();
-
-          // Note: name_size + 3 - is a space required to store: {char(name_size), char(1), name.data(), char(value)} string.
-          DMITIGR_ASSERT(name_size + 3 <= static_cast<std::size_t>(
-              std::cend(record) - p));
-          *p++ = static_cast<unsigned char>(name_size); // name_size
-          *p++ = static_cast<unsigned char>(1);         // 1
-          p = std::copy(cbegin(name), cend(name), p);   // name.data()
-          *p++ = static_cast<unsigned char>(value);     // value
-        }
 
-        using detail::Header;
-        const auto content_length = p - content_offset;
-        const auto padding_length = math::padding<std::streamsize>(content_length, 8);
-        const auto record_length = static_cast<int>(sizeof(Header)) +
-          content_length + padding_length;
-        auto* const h = reinterpret_cast<Header*>(record.data());
-        *h = detail::Header{detail::Record_type::get_values_result,
-          Header::null_request_id, static_cast<std::size_t>(content_length),
-          static_cast<std::size_t>(padding_length)};
-        const auto count = connection_->io_->write(
-          reinterpret_cast<const char*>(record.data()), record_length);
-        DMITIGR_ASSERT(count == record_length);
+        const auto record = detail::get_values_result(variables,
+          connection_->max_concurrent_request_count());
+        connection_->write(record.data(), record.size());
       } else {
         const detail::Unknown_type_record r{header.record_type()};
-        const std::streamsize record_length = sizeof(r);
-        const auto count = connection_->io_->write(
-          reinterpret_cast<const char*>(&r), record_length);
-        DMITIGR_ASSERT(count == record_length);
+        connection_->write(reinterpret_cast<const char*>(&r), sizeof(r));
       }
 
       return Process_header_result::management_processed;
@@ -622,6 +1158,10 @@ private:
     if (header.record_type() == detail::Record_type::begin_request) {
       end_request(detail::Protocol_status::cant_mpx_conn);
       result = Process_header_result::content_must_be_discarded;
+    } else if (header.record_type() == detail::Record_type::abort_request &&
+      header.request_id() == connection_->request_id()) {
+      connection_->abort();
+      result = Process_header_result::request_rejected;
     } else if (header.is_management_record())
       result = process_management_record();
     else if (header.request_id() != connection_->request_id())
@@ -636,6 +1176,251 @@ private:
     return result;
   }
 
+  /**
+   * @brief Sets the empty put area according to the flush policy.
+   *
+   * @details The guarded put area has zero size, so every write is performed
+   * by either xsputn() or overflow().
+   */
+  void reset_put_area()
+  {
+    if (coalesced_begin_ == coalesced_end_)
+      coalesced_begin_ = coalesced_end_ = 0;
+    auto* const begin = buffer_ + coalesced_end_ + sizeof(detail::Header);
+    setp(begin, is_put_area_guarded_ ? begin : begin + put_area_capacity());
+  }
+
+  /// Extends the put area to its full size preserving the content.
+  void open_put_area()
+  {
+    const auto size = static_cast<int>(pptr() - pbase());
+    setp(pbase(), pbase() + put_area_capacity());
+    pbump(size);
+  }
+
+  /**
+   * @returns The size of the put area which follows the coalesced records
+   * (excluding the byte reserved for overflow()).
+   */
+  std::streamsize put_area_capacity() const noexcept
+  {
+    return std::min<std::streamsize>(put_area_size_,
+      buffer_size_ - coalesced_end_ - sizeof(detail::Header) - 1);
+  }
+
+  /**
+   * @brief Completes the content of the put area followed by `ch` (unless
+   * it's EOF) as the record.
+   *
+   * @par Effects
+   * The record is located at [pbase() - sizeof(detail::Header), pptr()).
+   */
+  void finish_record(const int_type ch)
+  {
+    /*
+     * If `ch` is not EOF we need to place `ch` at the location pointed to by
+     * pptr(). (It's ok if pptr() == epptr() since that location is a valid
+     * writable location reserved for extra `ch`.)
+     * The content should be aligned by padding if necessary, and the record
+     * header must be injected at the reserved space before pbase().
+     * After that the result record will be ready to send to a client.
+     */
+    std::streamsize content_length = pptr() - pbase();
+    DMITIGR_ASSERT(content_length > 0);
+
+    // Store `ch` if it's not EOF.
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      DMITIGR_ASSERT(pptr() <= epptr());
+      *pptr() = static_cast<char>(ch);
+      pbump(1); // Yes, pptr() > epptr() is possible here, but this is ok.
+      content_length++;
+    }
+
+    // Aligning the content by padding if necessary.
+    const auto padding_length =
+      dmitigr::math::padding<std::streamsize>(content_length, 8);
+    DMITIGR_ASSERT(pptr() + padding_length <= buffer_ + buffer_size_);
+    std::memset(pptr(), 0, static_cast<std::size_t>(padding_length));
+    pbump(static_cast<int>(padding_length));
+
+    // Injecting the header.
+    auto* const header = reinterpret_cast<detail::Header*>(
+      pbase() - sizeof(detail::Header));
+    *header = detail::Header{static_cast<detail::Record_type>(type_),
+      connection_->request_id(),
+      static_cast<std::size_t>(content_length),
+      static_cast<std::size_t>(padding_length)};
+
+    is_put_area_at_least_once_consumed_ = true;
+  }
+
+  /**
+   * @brief Completes the content of the put area as the record to be sent
+   * along with the records of the subsequent flushes.
+   *
+   * @details The coalesced records are sent immediately upon reaching the
+   * coalescing limit, or if the buffer is half full.
+   *
+   * @returns EOF on failure.
+   */
+  int_type coalesce_put_area()
+  {
+    DMITIGR_ASSERT(coalescing_limit_);
+    if (is_end_of_stream_)
+      return traits_type::eof();
+
+    if (pptr() != pbase()) {
+      finish_record(traits_type::eof());
+      coalesced_end_ = pptr() - buffer_;
+      if (!coalesced_since_)
+        coalesced_since_ = std::chrono::steady_clock::now();
+    }
+    reset_put_area();
+
+    if (coalesced_end_ - coalesced_begin_ >= *coalescing_limit_ ||
+      coalesced_end_ >= buffer_size_ / 2)
+      return send_put_area(traits_type::eof(), true);
+
+    DMITIGR_ASSERT(is_invariant_ok());
+    return traits_type::not_eof(traits_type::eof());
+  }
+
+  /**
+   * @brief Sends the coalesced records without touching the put area.
+   *
+   * @par Requires
+   * `put_mutex_` is locked.
+   */
+  void send_coalesced()
+  {
+    DMITIGR_ASSERT(coalesced_begin_ < coalesced_end_);
+    auto iov = net::make_iovec(buffer_ + coalesced_begin_,
+      static_cast<std::size_t>(coalesced_end_ - coalesced_begin_));
+    {
+      const std::lock_guard lg{connection_->io_mutex_};
+      connection_->write(&iov, 1);
+      connection_->io_->uncork();
+    }
+    coalesced_begin_ = coalesced_end_;
+    coalesced_since_.reset();
+  }
+
+  /// Shrinks the guarded put area to its content.
+  void close_put_area()
+  {
+    if (is_put_area_guarded_) {
+      const auto size = static_cast<int>(pptr() - pbase());
+      setp(pbase(), pptr());
+      pbump(size);
+    }
+  }
+
+  /**
+   * @brief Writes to the guarded put area.
+   *
+   * @returns The number of bytes written.
+   *
+   * @par Requires
+   * `is_put_area_guarded()` and `put_mutex_` is locked.
+   */
+  std::streamsize write_guarded(const char_type* s, const std::streamsize count)
+  {
+    DMITIGR_ASSERT(is_put_area_guarded_);
+    open_put_area();
+    std::streamsize result{};
+    while (result < count) {
+      if (pptr() == epptr()) {
+        if (traits_type::eq_int_type(send_put_area(traits_type::eof(),
+            is_byte_threshold_flush_), traits_type::eof()))
+          break;
+        open_put_area();
+      }
+
+      auto n = std::min(count - result, epptr() - pptr());
+      const auto header_end = header_end_match_ >= 0 ?
+        find_header_block_end(s, n) : -1;
+      if (header_end >= 0)
+        n = header_end;
+      std::memcpy(pptr(), s, static_cast<std::size_t>(n));
+      pbump(static_cast<int>(n));
+      s += n;
+      result += n;
+
+      if (header_end >= 0) {
+        header_end_match_ = -1;
+        if (traits_type::eq_int_type(send_put_area(traits_type::eof(), true),
+            traits_type::eof()))
+          break;
+        is_put_area_guarded_ = bool(time_threshold_);
+        open_put_area();
+      }
+    }
+    if (pptr() != pbase() && !pending_since_)
+      pending_since_ = std::chrono::steady_clock::now();
+    close_put_area();
+    return result;
+  }
+
+  /**
+   * @brief Scans `s` for the end of the header block of HTTP response.
+   *
+   * @returns The number of bytes of `s` up to and including the end of the
+   * header block, or `-1` if the end is not found.
+   */
+  std::streamsize find_header_block_end(const char_type* const s,
+    const std::streamsize count) noexcept
+  {
+    DMITIGR_ASSERT(0 <= header_end_match_ && header_end_match_ < 4);
+    constexpr std::string_view crlfcrlf{"\r\n\r\n"};
+    for (std::streamsize i{}; i < count; ++i) {
+      if (s[i] == crlfcrlf[static_cast<std::size_t>(header_end_match_)]) {
+        if (++header_end_match_ == static_cast<int>(crlfcrlf.size()))
+          return i + 1;
+      } else
+        header_end_match_ = s[i] == '\r';
+    }
+    return -1;
+  }
+
+  /// Unregisters this instance from the flush timer.
+  void remove_from_flush_timer()
+  {
+    if (is_added_to_flush_timer_) {
+      connection_->flush_timer_->remove(this);
+      is_added_to_flush_timer_ = false;
+    }
+  }
+
+  /**
+   * @brief Switches the put area buffer to the next one after the zero-copy
+   * write of the current one.
+   *
+   * @details The buffers are rotated in a round-robin fashion and allocated
+   * on demand. Before reuse, the buffer is awaited to be released by the
+   * kernel, so the content producing overlaps with the transmission.
+   *
+   * @par Effects
+   * `buffer_` points to the buffer which can be modified.
+   */
+  void switch_put_buffer()
+  {
+    DMITIGR_ASSERT(!is_reader());
+    auto& io = *connection_->io_;
+    put_buffers_[put_buffer_index_].zerocopy_write_count =
+      io.zerocopy_write_count();
+    put_buffer_index_ = (put_buffer_index_ + 1) % put_buffers_.size();
+
+    auto& next = put_buffers_[put_buffer_index_];
+    if (!next.data) {
+      const auto size = static_cast<std::size_t>(buffer_size_);
+      if (!put_buffers_storage_)
+        put_buffers_storage_.reset(new char_type[(put_buffers_.size() - 1) * size]);
+      next.data = put_buffers_storage_.get() + (put_buffer_index_ - 1) * size;
+    }
+    io.wait_zerocopy(next.zerocopy_write_count);
+    buffer_ = next.data;
+  }
+
   /**
    * @brief Resets the input stream to read the data of the specified type.
    *
@@ -665,4 +1450,53 @@ private:
 #endif
 };
 
+inline void Flush_timer::run()
+{
+  std::vector<server_Streambuf*> due;
+  std::unique_lock lk{mutex_};
+  while (!is_stopped_) {
+    if (streambufs_.empty()) {
+      condition_.wait(lk);
+      continue;
+    }
+
+    // The period is a quarter of the minimum threshold.
+    auto period = streambufs_.front().second;
+    for (const auto& e : streambufs_)
+      period = std::min(period, e.second);
+    period = std::max(period / 4, std::chrono::milliseconds{1});
+
+    /*
+     * The flush can block on the write to the slow client, so it's performed
+     * without the mutex held in order to not block the (un)registration of
+     * other instances. The instance unregistered meanwhile is skipped.
+     */
+    const auto now = std::chrono::steady_clock::now();
+    due.clear();
+    for (const auto& e : streambufs_)
+      due.push_back(e.first);
+    for (auto* const streambuf : due) {
+      if (is_stopped_)
+        return;
+      else if (std::none_of(streambufs_.cbegin(), streambufs_.cend(),
+          [streambuf](const auto& e){return e.first == streambuf;}))
+        continue;
+
+      flushing_ = streambuf;
+      lk.unlock();
+      try {
+        streambuf->flush_expired(now);
+      } catch (const std::exception& e) {
+        std::clog << "error upon timed flush of FastCGI stream: " << e.what() << "\n";
+      } catch (...) {
+        std::clog << "unknown error upon timed flush of FastCGI stream\n";
+      }
+      lk.lock();
+      flushing_ = nullptr;
+      flushed_.notify_all();
+    }
+    condition_.wait_for(lk, period);
+  }
+}
+
 } // namespace dmitigr::fcgi::detail
@@ -25,9 +25,30 @@ enum class Stream_type;
 
 class Exception;
 
+class Authorizer_cache;
+class Body_spool;
+class Client;
+struct Client_response;
+class Compressed_ostream;
+enum class Content_coding;
+class Flush_policy;
+struct Form_field;
+class Form_fields;
+class Gateway;
+
 class Listener;
 class Listener_options;
 
+class Multipart_part;
+class Multipart_parser;
+
+class Prepared_response;
+class Record_encoder;
+struct Record_header;
+class Record_parser;
+class Response_cache;
+class Response_headers;
+
 class Connection_parameter;
 class Connection;
 class Server_connection;
@@ -38,6 +59,8 @@ class Stream;
 class Istream;
 class Ostream;
 
+class Writer;
+
 /// The implementation details.
 namespace detail {
 enum class Record_type : unsigned char;
@@ -60,6 +83,11 @@ class iIstream;
 class server_Istream;
 class iOstream;
 class server_Ostream;
+class Span_streambuf;
+class Deflate_streambuf;
+class Flush_timer;
+struct Client_request_state;
+class Client_connection;
 
 class Name_value;
 class Names_values;
@@ -0,0 +1,124 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../base/assert.hpp"
+#include "server_connection.hpp"
+#include "streams.hpp"
+#include "writer.hpp"
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+namespace dmitigr::fcgi {
+
+DMITIGR_FCGI_INLINE Writer::Writer(std::ostream& out)
+  : out_{&out}
+  , server_out_{dynamic_cast<detail::server_Streambuf*>(out.rdbuf())}
+{}
+
+DMITIGR_FCGI_INLINE std::ostream& Writer::stream() const noexcept
+{
+  return *out_;
+}
+
+DMITIGR_FCGI_INLINE Writer& Writer::write(const char* const data,
+  const std::size_t size)
+{
+  if (server_out_ && server_out_->is_closed())
+    out_->setstate(std::ios_base::badbit);
+  else if (server_out_ && size <=
+    static_cast<std::size_t>(server_out_->epptr() - server_out_->pptr())) {
+    std::memcpy(server_out_->pptr(), data, size);
+    server_out_->pbump(static_cast<int>(size));
+  } else if (out_->rdbuf()->sputn(data, static_cast<std::streamsize>(size)) !=
+    static_cast<std::streamsize>(size))
+    out_->setstate(std::ios_base::badbit);
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Writer& Writer::write_whole(const char* const data,
+  const std::size_t size)
+{
+  if (server_out_ && !server_out_->is_closed() &&
+    !server_out_->make_room(static_cast<std::streamsize>(size))) {
+    out_->setstate(std::ios_base::badbit);
+    return *this;
+  }
+  return write(data, size);
+}
+
+DMITIGR_FCGI_INLINE Writer& Writer::flush()
+{
+  out_->flush();
+  return *this;
+}
+
+DMITIGR_FCGI_INLINE Writer& Writer::write_integer(const long long value)
+{
+  return format(value);
+}
+
+DMITIGR_FCGI_INLINE Writer& Writer::write_integer(const unsigned long long value)
+{
+  return format(value);
+}
+
+DMITIGR_FCGI_INLINE Writer& Writer::write_floating(const float value)
+{
+  return format(value);
+}
+
+DMITIGR_FCGI_INLINE Writer& Writer::write_floating(const double value)
+{
+  return format(value);
+}
+
+template<typename T>
+Writer& Writer::format(const T value)
+{
+  constexpr std::size_t max_size{32};
+  const auto to_chars = [value](char* const first) noexcept
+  {
+#if !defined(__cpp_lib_to_chars) || __cpp_lib_to_chars < 201611L
+    if constexpr (std::is_floating_point_v<T>) {
+      // Note, that the decimal point depends on the C locale here.
+      const int size = std::snprintf(first, max_size, "%.*g",
+        std::is_same_v<T, float> ? 9 : 17, static_cast<double>(value));
+      return first + size;
+    } else {
+#endif
+      const auto [ptr, ec] = std::to_chars(first, first + max_size, value);
+      DMITIGR_ASSERT(ec == std::errc{});
+      return ptr;
+#if !defined(__cpp_lib_to_chars) || __cpp_lib_to_chars < 201611L
+    }
+#endif
+  };
+
+  if (server_out_ &&
+    server_out_->epptr() - server_out_->pptr() >= std::streamsize{max_size}) {
+    auto* const first = server_out_->pptr();
+    server_out_->pbump(static_cast<int>(to_chars(first) - first));
+    return *this;
+  } else {
+    char buffer[max_size];
+    return write(buffer, static_cast<std::size_t>(to_chars(buffer) - buffer));
+  }
+}
+
+} // namespace dmitigr::fcgi
@@ -0,0 +1,133 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_WRITER_HPP
+#define DMITIGR_FCGI_WRITER_HPP
+
+#include "dll.hpp"
+#include "types_fwd.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+
+namespace dmitigr::fcgi {
+
+/**
+ * @brief The locale-independent formatting writer to an output stream.
+ *
+ * @details Unlike `std::ostream`, the writer has no sentry, no locale and no
+ * formatting flags: the numbers are formatted by `std::to_chars()` (floating
+ * point numbers are formatted in the shortest form which round-trips), and
+ * the strings are copied as is. If the stream is the output stream of
+ * Server_connection, the data is placed straight into the put area of its
+ * stream buffer, and the stream buffer is involved only at the buffer edge.
+ * Otherwise, the data is written by `std::streambuf::sputn()`.
+ *
+ * @remarks The formatting flags of the stream have no effect. Upon failure,
+ * `std::ios_base::badbit` is set on the stream. (Writing to the closed output
+ * stream of Server_connection fails.)
+ */
+class Writer final {
+public:
+  /// Binds the writer to the `out`.
+  DMITIGR_FCGI_API explicit Writer(std::ostream& out);
+
+  /// @returns The stream the writer is bound to.
+  DMITIGR_FCGI_API std::ostream& stream() const noexcept;
+
+  /// Writes `size` bytes of `data`.
+  DMITIGR_FCGI_API Writer& write(const char* data, std::size_t size);
+
+  /**
+   * @brief Writes `size` bytes of `data` avoiding their split between records.
+   *
+   * @details If the stream is the output stream of Server_connection, and the
+   * data doesn't fit in the free space of the put area but fits in the empty
+   * put area, the stream is flushed before writing.
+   */
+  DMITIGR_FCGI_API Writer& write_whole(const char* data, std::size_t size);
+
+  /// Writes `str`.
+  Writer& operator<<(const std::string_view str)
+  {
+    return write(str.data(), str.size());
+  }
+
+  /// Writes `str`.
+  Writer& operator<<(const char* const str)
+  {
+    return *this << std::string_view{str};
+  }
+
+  /// Writes `c`.
+  Writer& operator<<(const char c)
+  {
+    return write(&c, 1);
+  }
+
+  /// Writes `value` as either `true` or `false`.
+  Writer& operator<<(const bool value)
+  {
+    return *this << (value ? std::string_view{"true"} : std::string_view{"false"});
+  }
+
+  /// Writes the decimal representation of `value`.
+  template<typename T>
+  std::enable_if_t<std::is_integral_v<T> &&
+    !std::is_same_v<T, bool> && !std::is_same_v<T, char>, Writer&>
+  operator<<(const T value)
+  {
+    if constexpr (std::is_signed_v<T>)
+      return write_integer(static_cast<long long>(value));
+    else
+      return write_integer(static_cast<unsigned long long>(value));
+  }
+
+  /// Writes the shortest representation of `value` which round-trips.
+  Writer& operator<<(const float value)
+  {
+    return write_floating(value);
+  }
+
+  /// @overload
+  Writer& operator<<(const double value)
+  {
+    return write_floating(value);
+  }
+
+  /// Flushes the stream.
+  DMITIGR_FCGI_API Writer& flush();
+
+private:
+  std::ostream* out_{};
+  detail::server_Streambuf* server_out_{};
+
+  DMITIGR_FCGI_API Writer& write_integer(long long value);
+  DMITIGR_FCGI_API Writer& write_integer(unsigned long long value);
+  DMITIGR_FCGI_API Writer& write_floating(float value);
+  DMITIGR_FCGI_API Writer& write_floating(double value);
+  template<typename T> Writer& format(T value);
+};
+
+} // namespace dmitigr::fcgi
+
+#ifndef DMITIGR_FCGI_NOT_HEADER_ONLY
+#include "writer.cpp"
+#endif
+
+#endif  // DMITIGR_FCGI_WRITER_HPP
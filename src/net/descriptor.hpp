@@ -23,16 +23,73 @@
 
 #include <algorithm>
 #include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <ios> // std::streamsize
 #include <utility> // std::move()
 
 #ifdef _WIN32
 #include "../os/windows.hpp"
+#else
+#include <sys/uio.h>
+#endif
+
+#if defined(__linux__) && defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#define DMITIGR_NET_ZEROCOPY
+#include <linux/errqueue.h>
+#include <poll.h>
 #endif
 
 namespace dmitigr::net {
 
+#ifdef _WIN32
+/// A buffer of scatter/gather I/O. (Has the same layout as POSIX `iovec`.)
+struct Iovec final {
+  /// The starting address of the buffer.
+  void* iov_base;
+
+  /// The size of the buffer.
+  std::size_t iov_len;
+};
+#else
+/// A buffer of scatter/gather I/O.
+using Iovec = ::iovec;
+#endif
+
+/// @returns The Iovec of the given buffer.
+inline Iovec make_iovec(const void* const buf, const std::size_t len) noexcept
+{
+  return Iovec{const_cast<void*>(buf), len};
+}
+
+/// The maximum number of buffers that can be passed to a single readv/writev.
+#ifdef IOV_MAX
+constexpr std::size_t max_iov_count{IOV_MAX};
+#else
+constexpr std::size_t max_iov_count{1024};
+#endif
+
+/// An output policy of a descriptor.
+enum class Output_policy {
+  /// Every write is transmitted immediately.
+  immediate,
+
+  /**
+   * @brief Writes performed while the descriptor is corked are flagged with
+   * `MSG_MORE` (if supported by the platform).
+   */
+  msg_more,
+
+  /**
+   * @brief The underlying TCP socket is corked with `TCP_CORK` (or
+   * `TCP_NOPUSH`) while the descriptor is corked.
+   */
+  cork
+};
+
 /// A descriptor to perform low-level I/O operations.
 class Descriptor {
 public:
@@ -48,20 +105,130 @@ public:
   /**
    * @brief Reads from this descriptor synchronously.
    *
-   * @returns Number of bytes read.
+   * @returns Number of bytes read, or `-1` if the descriptor is non-blocking
+   * and the operation would block.
    */
   virtual std::streamsize read(char* buf, std::streamsize len) = 0;
 
   /**
    * @brief Writes to this descriptor synchronously.
    *
-   * @returns Number of bytes written.
+   * @returns Number of bytes written, which can be less than `len`. (In
+   * particular, `0` is returned if the descriptor is non-blocking and the
+   * operation would block.)
    */
   virtual std::streamsize write(const char* buf, std::streamsize len) = 0;
 
+  /**
+   * @brief Reads from this descriptor into the `count` buffers pointed by `iov`
+   * synchronously. The buffers are filled in order.
+   *
+   * @returns Number of bytes read, or `-1` if the descriptor is non-blocking
+   * and the operation would block.
+   *
+   * @remarks At most `max_iov_count` buffers are used by a single call.
+   */
+  virtual std::streamsize readv(const Iovec* iov, std::size_t count) = 0;
+
+  /**
+   * @brief Writes the `count` buffers pointed by `iov` to this descriptor
+   * synchronously. The buffers are written in order.
+   *
+   * @returns Number of bytes written, which can be less than the total size
+   * of buffers. (In particular, `0` is returned if the descriptor is
+   * non-blocking and the operation would block.)
+   *
+   * @remarks At most `max_iov_count` buffers are used by a single call.
+   *
+   * @see write_all().
+   */
+  virtual std::streamsize writev(const Iovec* iov, std::size_t count) = 0;
+
+  /// @returns The output policy.
+  virtual Output_policy output_policy() const noexcept = 0;
+
+  /**
+   * @brief Sets the output policy.
+   *
+   * @par Effects
+   * `output_policy() == policy`.
+   *
+   * @throws Exception if the `policy` is not supported by the descriptor.
+   */
+  virtual void set_output_policy(Output_policy policy) = 0;
+
+  /**
+   * @brief Hints that more data is about to be written.
+   *
+   * @details Until uncork() is called, the data written might be deferred
+   * according to output_policy() in order to be transmitted in fewer, larger
+   * segments.
+   */
+  virtual void cork() = 0;
+
+  /// Transmits the data deferred since cork() was called.
+  virtual void uncork() = 0;
+
+  /**
+   * @brief Enables the zero-copy writes (`MSG_ZEROCOPY` on Linux).
+   *
+   * @returns `true` if the zero-copy writes are supported by the descriptor.
+   *
+   * @par Effects
+   * `is_zerocopy_enabled()` if the zero-copy writes are supported.
+   *
+   * @see writev_zerocopy().
+   */
+  virtual bool enable_zerocopy() = 0;
+
+  /// @returns `true` if the zero-copy writes are enabled.
+  virtual bool is_zerocopy_enabled() const noexcept = 0;
+
+  /**
+   * @brief Writes like writev() but without copying the data into the kernel
+   * if is_zerocopy_enabled().
+   *
+   * @details If the kernel reports that it had to copy the data anyway (for
+   * example, on loopback), the subsequent writes are performed as writev().
+   *
+   * @returns Number of bytes written.
+   *
+   * @remarks The buffers pointed by `iov` must not be modified or freed until
+   * they are released by the kernel, i.e. until the completion of the write,
+   * which number is `zerocopy_write_count()` after the call.
+   *
+   * @see wait_zerocopy().
+   */
+  virtual std::streamsize writev_zerocopy(const Iovec* iov, std::size_t count) = 0;
+
+  /// @returns The number of the zero-copy writes performed.
+  virtual std::uint64_t zerocopy_write_count() const noexcept = 0;
+
+  /**
+   * @brief Waits until the buffers of the first `count` zero-copy writes are
+   * released by the kernel.
+   *
+   * @throws Exception if the socket is hung up or failed without releasing
+   * the buffers.
+   *
+   * @par Requires
+   * `count <= zerocopy_write_count()`.
+   */
+  virtual void wait_zerocopy(std::uint64_t count) = 0;
+
   /// Closes the descriptor.
   virtual void close() = 0;
 
+  /**
+   * @brief Closes the descriptor without waiting for the peer.
+   *
+   * @details Unlike close(), only the data already received from the peer is
+   * discarded before closing, i.e. the end of the data sent by the peer is not
+   * awaited. (The data which arrives after that may cause the peer to receive
+   * a reset.)
+   */
+  virtual void close_promptly() = 0;
+
   /// @returns Native handle (i.e. socket or named pipe).
   virtual std::intptr_t native_handle() = 0;
 };
@@ -80,6 +247,90 @@ public:
   {
     return 2147479552; // as on Linux
   }
+
+  std::streamsize readv(const Iovec* const iov, std::size_t count) override
+  {
+    if (!iov && count)
+      throw Exception{"cannot read to null buffers"};
+
+    std::streamsize result{};
+    count = std::min(count, max_iov_count);
+    for (std::size_t i{}; i < count; ++i) {
+      const auto len = static_cast<std::streamsize>(iov[i].iov_len);
+      const auto n = read(static_cast<char*>(iov[i].iov_base), len);
+      if (n < 0)
+        return result ? result : n;
+      result += n;
+      if (n < len)
+        break;
+    }
+    return result;
+  }
+
+  std::streamsize writev(const Iovec* const iov, std::size_t count) override
+  {
+    if (!iov && count)
+      throw Exception{"cannot write from null buffers"};
+
+    std::streamsize result{};
+    count = std::min(count, max_iov_count);
+    for (std::size_t i{}; i < count; ++i) {
+      const auto len = static_cast<std::streamsize>(iov[i].iov_len);
+      const auto n = write(static_cast<const char*>(iov[i].iov_base), len);
+      result += n;
+      if (n < len)
+        break;
+    }
+    return result;
+  }
+
+  Output_policy output_policy() const noexcept override
+  {
+    return Output_policy::immediate;
+  }
+
+  void set_output_policy(const Output_policy policy) override
+  {
+    if (policy != Output_policy::immediate)
+      throw Exception{"unsupported output policy of descriptor"};
+  }
+
+  void cork() override
+  {}
+
+  void uncork() override
+  {}
+
+  void close_promptly() override
+  {
+    close();
+  }
+
+  bool enable_zerocopy() override
+  {
+    return false;
+  }
+
+  bool is_zerocopy_enabled() const noexcept override
+  {
+    return false;
+  }
+
+  std::streamsize writev_zerocopy(const Iovec* const iov,
+    const std::size_t count) override
+  {
+    return writev(iov, count);
+  }
+
+  std::uint64_t zerocopy_write_count() const noexcept override
+  {
+    return 0;
+  }
+
+  void wait_zerocopy(const std::uint64_t count) override
+  {
+    DMITIGR_ASSERT(count <= zerocopy_write_count());
+  }
 };
 
 /// The implementation of Descriptor based on sockets.
@@ -117,8 +368,11 @@ public:
     const auto buf_len = static_cast<std::size_t>(len);
 #endif
     const auto result = ::recv(socket_, buf, buf_len, flags);
-    if (net::is_socket_error(result))
+    if (net::is_socket_error(result)) {
+      if (is_last_error_would_block())
+        return -1;
       throw DMITIGR_NET_EXCEPTION{"cannot read from socket"};
+    }
 
     return static_cast<std::streamsize>(result);
   }
@@ -129,27 +383,206 @@ public:
       throw Exception{"cannot write to socket from null buffer"};
 
     len = std::min(len, max_write_size());
-#if defined(_WIN32) || defined(__APPLE__)
-    constexpr int flags{};
-#else
-    constexpr int flags{MSG_NOSIGNAL};
-#endif
+    const int flags{send_flags()};
 #ifdef _WIN32
     const auto buf_len = static_cast<int>(len);
 #else
     const auto buf_len = static_cast<std::size_t>(len);
 #endif
     const auto result = ::send(socket_, buf, buf_len, flags);
-    if (net::is_socket_error(result))
+    if (net::is_socket_error(result)) {
+      if (is_last_error_would_block())
+        return 0;
       throw DMITIGR_NET_EXCEPTION{"cannot write to socket"};
+    }
+
+    is_more_pending_ = is_more_flagged(flags);
+    return static_cast<std::streamsize>(result);
+  }
+
+#ifndef _WIN32
+  std::streamsize readv(const Iovec* const iov, const std::size_t count) override
+  {
+    if (!iov && count)
+      throw Exception{"cannot read from socket to null buffers"};
+
+    auto msg = make_msghdr(iov, count);
+    constexpr int flags{};
+    const auto result = ::recvmsg(socket_, &msg, flags);
+    if (net::is_socket_error(result)) {
+      if (is_last_error_would_block())
+        return -1;
+      throw DMITIGR_NET_EXCEPTION{"cannot read from socket"};
+    }
 
     return static_cast<std::streamsize>(result);
   }
 
+  std::streamsize writev(const Iovec* const iov, const std::size_t count) override
+  {
+    if (!iov && count)
+      throw Exception{"cannot write to socket from null buffers"};
+
+    return sendmsg(iov, count, send_flags());
+  }
+#endif
+
+#ifdef DMITIGR_NET_ZEROCOPY
+  bool enable_zerocopy() override
+  {
+    if (is_zerocopy_enabled_)
+      return true;
+
+    constexpr int value{1};
+    if (::setsockopt(socket_, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value))) {
+      if (errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+        return false;
+      throw DMITIGR_NET_EXCEPTION{"cannot set SO_ZEROCOPY socket option"};
+    }
+    return is_zerocopy_enabled_ = true;
+  }
+
+  bool is_zerocopy_enabled() const noexcept override
+  {
+    return is_zerocopy_enabled_;
+  }
+
+  std::streamsize writev_zerocopy(const Iovec* const iov,
+    const std::size_t count) override
+  {
+    if (!iov && count)
+      throw Exception{"cannot write to socket from null buffers"};
+
+    if (!is_zerocopy_enabled_ || is_zerocopy_copied_)
+      return writev(iov, count);
+
+    const auto msg = make_msghdr(iov, count);
+    const int flags{send_flags()};
+    const auto result = ::sendmsg(socket_, &msg, flags | MSG_ZEROCOPY);
+    if (net::is_socket_error(result)) {
+      if (is_last_error_would_block())
+        return 0;
+      else if (errno == ENOBUFS) // the limit of pinned pages is exceeded
+        return writev(iov, count);
+      throw DMITIGR_NET_EXCEPTION{"cannot write to socket"};
+    }
+
+    is_more_pending_ = is_more_flagged(flags);
+    if (result > 0)
+      ++zerocopy_write_count_; // the kernel notifies on each such a write
+    return static_cast<std::streamsize>(result);
+  }
+
+  std::uint64_t zerocopy_write_count() const noexcept override
+  {
+    return zerocopy_write_count_;
+  }
+
+  void wait_zerocopy(const std::uint64_t count) override
+  {
+    DMITIGR_ASSERT(count <= zerocopy_write_count_);
+    while (zerocopy_completion_count_ < count) {
+      /*
+       * The completion notifications are queued into the error queue of the
+       * socket which is signaled by POLLERR, that is always polled.
+       */
+      ::pollfd pfd{socket_, 0, 0};
+      if (::poll(&pfd, 1, -1) < 0) {
+        if (errno == EINTR)
+          continue;
+        throw DMITIGR_NET_EXCEPTION{"cannot poll socket"};
+      }
+      const auto completion_count = zerocopy_completion_count_;
+      read_zerocopy_completions();
+
+      /*
+       * POLLHUP, POLLNVAL and the pending socket error are reported by poll()
+       * persistently, so unless some completions are read, the socket is
+       * considered unusable instead of polling it again and again.
+       */
+      if (zerocopy_completion_count_ == completion_count) {
+        if (pfd.revents & POLLNVAL)
+          throw Exception{"cannot wait for zero-copy completions on invalid "
+            "socket"};
+        else if (pfd.revents & POLLHUP)
+          throw Exception{"cannot wait for zero-copy completions on hung up "
+            "socket"};
+        else if (pfd.revents & POLLERR) {
+          int error{};
+          ::socklen_t error_size{sizeof(error)};
+          if (::getsockopt(socket_, SOL_SOCKET, SO_ERROR, &error, &error_size))
+            throw DMITIGR_NET_EXCEPTION{"cannot get SO_ERROR socket option"};
+          else if (error) {
+            errno = error;
+            throw DMITIGR_NET_EXCEPTION{"cannot wait for zero-copy completions"};
+          }
+        }
+      }
+    }
+  }
+#endif
+
+  Output_policy output_policy() const noexcept override
+  {
+    return output_policy_;
+  }
+
+  void set_output_policy(const Output_policy policy) override
+  {
+    if (policy == output_policy_)
+      return;
+#ifndef MSG_MORE
+    else if (policy == Output_policy::msg_more)
+      throw Exception{"MSG_MORE output policy is not supported"};
+#endif
+    else if (policy == Output_policy::cork && !is_tcp_cork_supported())
+      throw Exception{"TCP_CORK output policy is not supported"};
+
+    uncork();
+    output_policy_ = policy;
+  }
+
+  void cork() override
+  {
+    if (is_corked_)
+      return;
+
+    if (output_policy_ == Output_policy::cork)
+      set_tcp_cork(socket_, true);
+    is_corked_ = true;
+  }
+
+  void uncork() override
+  {
+    if (!is_corked_)
+      return;
+
+    /*
+     * Note, that clearing TCP_CORK pushes out the pending frames even if the
+     * socket was not corked with TCP_CORK but the last write was flagged with
+     * MSG_MORE.
+     */
+    if (output_policy_ == Output_policy::cork || is_more_pending_)
+      set_tcp_cork(socket_, false);
+    is_corked_ = false;
+    is_more_pending_ = false;
+  }
+
   void close() override
   {
     if (!is_shutted_down_) {
-      graceful_shutdown();
+      graceful_shutdown(std::chrono::seconds{1});
+      is_shutted_down_ = true;
+    }
+
+    if (socket_.close() != 0)
+      throw os::Sys_exception{"cannot close socket"};
+  }
+
+  void close_promptly() override
+  {
+    if (!is_shutted_down_) {
+      graceful_shutdown(std::chrono::milliseconds{0});
       is_shutted_down_ = true;
     }
 
@@ -164,15 +597,121 @@ public:
 
 private:
   bool is_shutted_down_{};
+  bool is_corked_{};
+  bool is_more_pending_{};
+  Output_policy output_policy_{Output_policy::immediate};
+#ifdef DMITIGR_NET_ZEROCOPY
+  bool is_zerocopy_enabled_{};
+  bool is_zerocopy_copied_{};
+  std::uint64_t zerocopy_write_count_{};
+  std::uint64_t zerocopy_completion_count_{};
+#endif
   net::Socket_guard socket_;
 
+  /// @returns The flags for send().
+  int send_flags() const noexcept
+  {
+#if defined(_WIN32) || defined(__APPLE__)
+    int result{};
+#else
+    int result{MSG_NOSIGNAL};
+#endif
+#ifdef MSG_MORE
+    if (is_corked_ && output_policy_ == Output_policy::msg_more)
+      result |= MSG_MORE;
+#endif
+    return result;
+  }
+
+#ifndef _WIN32
+  /// @returns The message header to pass to sendmsg() or recvmsg().
+  static ::msghdr make_msghdr(const Iovec* const iov, const std::size_t count) noexcept
+  {
+    ::msghdr result{};
+    result.msg_iov = const_cast<Iovec*>(iov);
+    result.msg_iovlen = static_cast<decltype(result.msg_iovlen)>(
+      std::min(count, max_iov_count));
+    return result;
+  }
+
+  /// Writes the buffers by using sendmsg() with the specified `flags`.
+  std::streamsize sendmsg(const Iovec* const iov, const std::size_t count,
+    const int flags)
+  {
+    /*
+     * Note, that sendmsg() is used instead of writev() in order to
+     * pass the flags (MSG_NOSIGNAL in particular).
+     */
+    const auto msg = make_msghdr(iov, count);
+    const auto result = ::sendmsg(socket_, &msg, flags);
+    if (net::is_socket_error(result)) {
+      if (is_last_error_would_block())
+        return 0;
+      throw DMITIGR_NET_EXCEPTION{"cannot write to socket"};
+    }
+
+    is_more_pending_ = is_more_flagged(flags);
+    return static_cast<std::streamsize>(result);
+  }
+#endif
+
+#ifdef DMITIGR_NET_ZEROCOPY
+  /// Reads all the zero-copy completion notifications from the error queue.
+  void read_zerocopy_completions()
+  {
+    while (true) {
+      alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(::sock_extended_err))
+        + CMSG_SPACE(sizeof(::sockaddr_in6))];
+      ::msghdr msg{};
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(socket_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        if (is_last_error_would_block())
+          return;
+        else if (errno == EINTR)
+          continue;
+        throw DMITIGR_NET_EXCEPTION{"cannot read error queue of socket"};
+      }
+
+      for (auto* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+            (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+          continue;
+
+        ::sock_extended_err err;
+        std::memcpy(&err, CMSG_DATA(cm), sizeof(err));
+        if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno)
+          continue;
+
+        // The notification covers the range [ee_info, ee_data] of writes.
+        zerocopy_completion_count_ += static_cast<std::uint32_t>(
+          err.ee_data - err.ee_info) + 1;
+        if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+          is_zerocopy_copied_ = true; // no reason for zero-copy anymore
+      }
+    }
+  }
+#endif
+
+  /// @returns `true` if the `flags` contains `MSG_MORE`.
+  static constexpr bool is_more_flagged(const int flags) noexcept
+  {
+#ifdef MSG_MORE
+    return flags & MSG_MORE;
+#else
+    (void)flags;
+    return false;
+#endif
+  }
+
   /**
    * @brief Gracefully shutting down the socket.
    *
    * @details Shutting down the send side and receiving the data from the client
-   * till the timeout or end to prevent sending a TCP RST to the client.
+   * till the `timeout` (of waiting for the next data) or end to prevent sending
+   * a TCP RST to the client.
    */
-  void graceful_shutdown()
+  void graceful_shutdown(const std::chrono::milliseconds timeout)
   {
     constexpr const char* const errmsg{"cannot shutdown socket gracefully"};
     if (const auto r = ::shutdown(socket_, net::sd_send)) {
@@ -183,7 +722,7 @@ private:
     }
     while (true) {
       using Sr = net::Socket_readiness;
-      const auto mask = net::poll(socket_, Sr::read_ready, std::chrono::seconds{1});
+      const auto mask = net::poll(socket_, Sr::read_ready, timeout);
       if (!bool(mask & Sr::read_ready))
         break; // timeout (ok)
 
@@ -276,7 +815,82 @@ private:
 
 #endif  // _WIN32
 
+/// Waits until the socket of `io` becomes writable.
+inline void wait_writable(Descriptor& io)
+{
+  using Sr = Socket_readiness;
+  const auto socket = static_cast<Socket_native>(io.native_handle());
+  const auto mask = poll(socket, Sr::write_ready, std::chrono::milliseconds{-1});
+  DMITIGR_ASSERT(bool(mask & Sr::write_ready));
+}
+
 } // namespace detail
+
+/**
+ * @brief Writes `len` bytes of `buf` to `io` by repeating the write until
+ * all the data is written.
+ *
+ * @remarks If `io` is non-blocking, waits for it to become writable as
+ * many times as needed.
+ */
+inline void write_all(Descriptor& io, const char* buf, std::streamsize len)
+{
+  if (!buf && len)
+    throw Exception{"cannot write from null buffer"};
+
+  while (len > 0) {
+    const auto count = io.write(buf, len);
+    DMITIGR_ASSERT(0 <= count && count <= len);
+    if (!count)
+      detail::wait_writable(io);
+    buf += count;
+    len -= count;
+  }
+}
+
+/**
+ * @overload
+ *
+ * @details Writes the `count` buffers pointed by `iov` by repeating the
+ * vectored write until all the data is written.
+ *
+ * @par Effects
+ * The buffers pointed by `iov` are consumed (i.e. modified) in the course of
+ * writing.
+ */
+inline void write_all(Descriptor& io, Iovec* iov, std::size_t count)
+{
+  if (!iov && count)
+    throw Exception{"cannot write from null buffers"};
+
+  while (true) {
+    // Skipping the empty buffers.
+    while (count && !iov->iov_len) {
+      ++iov;
+      --count;
+    }
+    if (!count)
+      break;
+
+    auto written = static_cast<std::size_t>(io.writev(iov, count));
+    if (!written)
+      detail::wait_writable(io);
+
+    // Consuming the written buffers.
+    while (written) {
+      DMITIGR_ASSERT(count);
+      const auto n = std::min(written, iov->iov_len);
+      iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+      iov->iov_len -= n;
+      written -= n;
+      if (!iov->iov_len) {
+        ++iov;
+        --count;
+      }
+    }
+  }
+}
+
 } // namespace dmitigr::net
 
 #endif  // DMITIGR_NET_DESCRIPTOR_HPP
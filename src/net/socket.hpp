@@ -21,6 +21,7 @@
 #include "../util/enum_bitmask.hpp"
 #include "address.hpp"
 #include "exceptions.hpp"
+#include "last_error.hpp"
 
 #include <algorithm>
 #include <cassert>
@@ -37,6 +38,9 @@
 #else
 #include <cerrno>
 
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h> // TCP_NODELAY, TCP_CORK
 #include <sys/time.h> // timeval
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -112,6 +116,39 @@ inline bool is_socket_error(const Integer function_result)
 #endif
 }
 
+/**
+ * @returns `true` if the last socket operation failed because the socket
+ * is non-blocking and the operation would block.
+ */
+inline bool is_last_error_would_block() noexcept
+{
+  const int err = last_error();
+#ifdef _WIN32
+  return err == WSAEWOULDBLOCK;
+#else
+#if EAGAIN == EWOULDBLOCK
+  return err == EAGAIN;
+#else
+  return err == EAGAIN || err == EWOULDBLOCK;
+#endif
+#endif
+}
+
+/// Sets the non-blocking mode of the `socket`.
+inline void set_nonblocking(const Socket_native socket, const bool value)
+{
+#ifdef _WIN32
+  u_long mode = value;
+  const bool ok = ::ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+  const int flags = ::fcntl(socket, F_GETFL, 0);
+  const bool ok = flags >= 0 && ::fcntl(socket, F_SETFL,
+    value ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)) == 0;
+#endif
+  if (!ok)
+    throw DMITIGR_NET_EXCEPTION{"cannot set non-blocking mode of socket"};
+}
+
 /// Sets the receiving or sending timeouts until reporting an error.
 inline void set_timeout(const Socket_native socket,
   const std::chrono::milliseconds rcv_timeout,
@@ -152,6 +189,61 @@ inline void set_timeout(const Socket_native socket,
     throw DMITIGR_NET_EXCEPTION{"cannot set timeout on a socket"};
 }
 
+/// Sets the option `TCP_NODELAY` (i.e. disables the Nagle's algorithm).
+inline void set_tcp_nodelay(const Socket_native socket, const bool value)
+{
+  const int optval = value;
+#ifdef _WIN32
+  const auto optlen = static_cast<int>(sizeof(optval));
+#else
+  const auto optlen = static_cast<::socklen_t>(sizeof(optval));
+#endif
+  if (::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+      reinterpret_cast<const char*>(&optval), optlen) != 0)
+    throw DMITIGR_NET_EXCEPTION{"cannot set TCP_NODELAY socket option"};
+}
+
+/// @returns `true` if set_tcp_cork() is supported on the current platform.
+constexpr bool is_tcp_cork_supported() noexcept
+{
+#if defined(TCP_CORK) || defined(TCP_NOPUSH)
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Corks (or uncorks) the TCP `socket`.
+ *
+ * @details While the socket is corked, the partial frames are not sent. Upon
+ * uncorking, all the queued data is sent immediately.
+ *
+ * @par Requires
+ * `is_tcp_cork_supported()`.
+ *
+ * @remarks The option `TCP_NOPUSH` is used on the BSD-like systems.
+ */
+inline void set_tcp_cork(const Socket_native socket, const bool value)
+{
+#if defined(TCP_CORK) || defined(TCP_NOPUSH)
+#ifdef TCP_CORK
+  constexpr int optname{TCP_CORK};
+#else
+  constexpr int optname{TCP_NOPUSH};
+#endif
+  const int optval = value;
+  const auto optlen = static_cast<::socklen_t>(sizeof(optval));
+  if (::setsockopt(socket, IPPROTO_TCP, optname,
+      reinterpret_cast<const char*>(&optval), optlen) != 0)
+    throw DMITIGR_NET_EXCEPTION{"cannot set TCP_CORK socket option"};
+#else
+  (void)socket;
+  (void)value;
+  throw Exception{"TCP_CORK socket option is not supported"};
+#endif
+}
+
 // =============================================================================
 
 #ifdef _WIN32
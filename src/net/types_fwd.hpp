@@ -23,6 +23,7 @@ namespace dmitigr::net {
 class Socket_guard;
 
 enum class Communication_mode;
+enum class Output_policy;
 enum class Socket_readiness;
 enum class Protocol_family;
 
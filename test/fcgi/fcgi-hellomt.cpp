@@ -47,7 +47,8 @@ int main()
               << "  backlog = " << backlog << "\n"
               << "  thread pool size = " << pool_size << std::endl;
 
-    fcgi::Listener server{fcgi::Listener_options{"0.0.0.0", port, backlog}};
+    fcgi::Listener server{fcgi::Listener_options{"0.0.0.0", port, backlog}
+      .set_max_connection_count(pool_size)};
     server.listen();
     std::vector<std::thread> threads(pool_size);
     for (auto& t : threads)
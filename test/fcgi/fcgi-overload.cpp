@@ -17,8 +17,7 @@
 #include "../../src/base/assert.hpp"
 #include "../../src/fcgi/fcgi.hpp"
 
-#include <atomic>
-#include <cassert>
+#include <chrono>
 #include <iostream>
 #include <thread>
 #include <vector>
@@ -27,35 +26,6 @@ namespace {
 
 constexpr std::size_t pool_size = 64;
 
-class Busyness_counter {
-public:
-  ~Busyness_counter()
-  {
-    assert(value_ >= 1);
-    value_--;
-  }
-
-  Busyness_counter()
-  {
-    value_++;
-  }
-
-  static std::size_t value()
-  {
-    return value_;
-  }
-
-private:
-  static std::atomic<std::size_t> value_;
-};
-
-std::atomic<std::size_t> Busyness_counter::value_{};
-
-bool is_ready()
-{
-  return Busyness_counter::value() <= pool_size;
-}
-
 } // namespace
 
 int main(int, char**)
@@ -65,17 +35,14 @@ int main(int, char**)
     const auto serve = [](auto* const server)
     {
       while (true) {
-        const auto conn = server->accept();
-        if (is_ready()) {
-          const Busyness_counter counter;
+        // The requests beyond the pool size are rejected by accept().
+        if (const auto conn = server->accept()) {
           conn->out() << "Content-Type: text/plain" << fcgi::crlfcrlf;
           // Simulate being busy.
           std::this_thread::sleep_for(std::chrono::milliseconds{50});
           conn->out() << "Hello from dmitigr::fcgi!" << fcgi::crlf;
-        } else
-          // Report "Service Unavailable".
-          conn->out() << "Status: 503" << fcgi::crlfcrlf;
-        conn->close(); // optional.
+          conn->close(); // optional.
+        }
       }
     };
 
@@ -88,7 +55,9 @@ int main(int, char**)
       << "  working thread pool size = " << pool_size << "\n"
       << "  overload thread pool size = " << overload_pool_size << std::endl;
 
-    fcgi::Listener server{fcgi::Listener_options{"0.0.0.0", port, backlog}};
+    fcgi::Listener server{fcgi::Listener_options{"0.0.0.0", port, backlog}
+      .set_max_connection_count(pool_size)
+      .set_max_in_flight_request_count(pool_size)};
     DMITIGR_ASSERT(!server.is_listening());
     server.listen();
     DMITIGR_ASSERT(server.is_listening());
@@ -0,0 +1,121 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    namespace net = dmitigr::net;
+    namespace test = dmitigr::fcgi::test;
+
+    const int port{9875};
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+    server.listen();
+
+    // Abort upon processing.
+    {
+      std::atomic_int handler_call_count{};
+      std::thread handler{[&server, &handler_call_count]
+      {
+        const auto conn = server.accept();
+        conn->set_abort_handler([&handler_call_count]{++handler_call_count;});
+        DMITIGR_ASSERT(conn->read_body().empty());
+        conn->out() << "before" << std::flush;
+        for (int i{}; i < 500 && !conn->poll_abort(); ++i)
+          std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        DMITIGR_ASSERT(conn->is_aborted());
+        conn->out() << "after";
+      }};
+      auto io = test::send(port, test::Request{}.records());
+      test::Response response;
+      while (response.out().size() < 6)
+        DMITIGR_ASSERT(response.read(*io));
+      DMITIGR_ASSERT(response.out() == "before");
+      DMITIGR_ASSERT(!response.is_end());
+      test::send(*io, test::record(2));
+      DMITIGR_ASSERT(response.read_to_end(*io).out() == "before");
+      io.reset();
+      handler.join();
+      DMITIGR_ASSERT(handler_call_count == 1);
+    }
+
+    // Abort upon reading the input stream.
+    {
+      std::thread handler{[&server]
+      {
+        const auto conn = server.accept();
+        DMITIGR_ASSERT(conn->read_body() == "abc");
+        DMITIGR_ASSERT(conn->is_aborted());
+        bool is_called{};
+        conn->set_abort_handler([&is_called]{is_called = true;});
+        DMITIGR_ASSERT(is_called);
+        conn->out() << "discarded";
+      }};
+      auto io = test::send(port, test::Request{}.begin() +
+        test::record(5, "abc") + test::record(2));
+      DMITIGR_ASSERT(test::Response{}.read_to_end(*io).out().empty());
+      io.reset();
+      handler.join();
+    }
+
+    // Connection closed by the client.
+    {
+      std::thread handler{[&server]
+      {
+        const auto conn = server.accept();
+        DMITIGR_ASSERT(conn->read_body().empty());
+        for (int i{}; i < 500 && !conn->poll_abort(); ++i)
+          std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        DMITIGR_ASSERT(conn->is_aborted());
+      }};
+      auto io = test::send(port, test::Request{}.records());
+      ::shutdown(static_cast<net::Socket_native>(io->native_handle()),
+        net::sd_send);
+      DMITIGR_ASSERT(test::Response{}.read_to_end(*io).out().empty());
+      io.reset();
+      handler.join();
+    }
+
+    // No abort.
+    {
+      std::thread handler{[&server]
+      {
+        const auto conn = server.accept();
+        DMITIGR_ASSERT(conn->read_body().empty());
+        DMITIGR_ASSERT(!conn->poll_abort());
+        DMITIGR_ASSERT(!conn->is_aborted());
+        conn->out() << "ok";
+      }};
+      auto io = test::send(port, test::Request{}.records());
+      DMITIGR_ASSERT(test::Response{}.read_to_end(*io).out() == "ok");
+      io.reset();
+      handler.join();
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,130 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    using std::chrono::milliseconds;
+    using std::chrono::seconds;
+
+    // Insertion, lookup and expiration.
+    {
+      fcgi::Authorizer_cache cache{{"HTTP_AUTHORIZATION"}, seconds{60},
+        milliseconds{1}, 1 << 20, 4};
+      DMITIGR_ASSERT(cache.parameters().size() == 1);
+      DMITIGR_ASSERT(cache.allow_ttl() == seconds{60});
+      DMITIGR_ASSERT(cache.deny_ttl() == milliseconds{1});
+      DMITIGR_ASSERT(cache.allow_response().content_size());
+      DMITIGR_ASSERT(cache.deny_response().content_size());
+      DMITIGR_ASSERT(!cache.find("a"));
+      DMITIGR_ASSERT(cache.insert("a", true));
+      DMITIGR_ASSERT(cache.insert("b", false));
+      DMITIGR_ASSERT(cache.size() == 2);
+      DMITIGR_ASSERT(cache.find("a") == true);
+      std::this_thread::sleep_for(milliseconds{10});
+      DMITIGR_ASSERT(!cache.find("b"));
+      DMITIGR_ASSERT(cache.insert("a", false));
+      DMITIGR_ASSERT(cache.find("a") == false);
+      DMITIGR_ASSERT(cache.erase("a") && !cache.erase("a"));
+      cache.insert("c", true);
+      cache.clear();
+      DMITIGR_ASSERT(!cache.size());
+    }
+
+    // Serving.
+    {
+      const int port{9878};
+      fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+      server.listen();
+      fcgi::Authorizer_cache cache{{"HTTP_AUTHORIZATION", "REQUEST_URI"},
+        seconds{60}, seconds{60}, 1 << 20};
+      std::atomic_int decision_count{};
+      std::atomic_bool is_stopped{};
+      std::thread thread{[&]
+      {
+        while (!is_stopped) {
+          if (!server.wait(milliseconds{50}))
+            continue;
+          const auto conn = server.accept();
+          cache.serve(*conn, [&decision_count](fcgi::Server_connection& conn)
+          {
+            ++decision_count;
+            return conn.parameter("HTTP_AUTHORIZATION") == "good";
+          });
+        }
+      }};
+
+      {
+        fcgi::Client client{{"127.0.0.1", port}, 1};
+        const auto authorize = [&client](const std::string_view authorization,
+          const std::string_view uri)
+        {
+          const auto response = client.request({{"HTTP_AUTHORIZATION",
+            authorization}, {"REQUEST_URI", uri}}, {}, fcgi::Role::authorizer);
+          DMITIGR_ASSERT(!response.application_status);
+          return response.out;
+        };
+        for (int i{}; i < 3; ++i) {
+          DMITIGR_ASSERT(authorize("good", "/a").find("Status: 200") == 0);
+          DMITIGR_ASSERT(authorize("bad", "/a").find("Status: 403") == 0);
+          DMITIGR_ASSERT(authorize("good", "/b").find("Status: 200") == 0);
+        }
+        DMITIGR_ASSERT(decision_count == 3);
+        DMITIGR_ASSERT(cache.size() == 3);
+      }
+      is_stopped = true;
+      thread.join();
+    }
+
+    // Non-authorizer request.
+    {
+      const int port{9878};
+      fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+      server.listen();
+      std::thread thread{[port]
+      {
+        fcgi::Client{{"127.0.0.1", port}, 1}.request({});
+      }};
+      fcgi::Authorizer_cache cache{{}, seconds{1}, seconds{1}, 1 << 10};
+      auto conn = server.accept();
+      bool is_thrown{};
+      try {
+        cache.serve(*conn, [](fcgi::Server_connection&){return true;});
+      } catch (const fcgi::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+      conn.reset();
+      thread.join();
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,87 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+
+    // In memory.
+    {
+      fcgi::Body_spool spool{8};
+      spool.append("Hello", 5);
+      DMITIGR_ASSERT(!spool.is_spilled());
+      DMITIGR_ASSERT(spool.size() == 5);
+      DMITIGR_ASSERT(spool.view() == "Hello");
+    }
+
+    // Spilled.
+    {
+      std::string body;
+      for (int i = 0; i < 10000; ++i)
+        body.append(std::to_string(i)).append(",");
+      std::istringstream in{body};
+      fcgi::Body_spool spool{1024};
+      DMITIGR_ASSERT(spool.append(in) == body.size());
+#ifndef _WIN32
+      DMITIGR_ASSERT(spool.is_spilled());
+      DMITIGR_ASSERT(spool.file_descriptor() >= 0);
+#endif
+      DMITIGR_ASSERT(spool.size() == body.size());
+      DMITIGR_ASSERT(spool.view() == body);
+
+      spool.append("end", 3);
+      DMITIGR_ASSERT(spool.view() == body + "end");
+
+      auto& stream = spool.stream();
+      std::string number;
+      std::getline(stream, number, ',');
+      DMITIGR_ASSERT(number == "0");
+      stream.seekg(-8, std::ios_base::end);
+      std::getline(stream, number, ',');
+      DMITIGR_ASSERT(number == "9999");
+      stream.seekg(0);
+      std::getline(stream, number, ',');
+      DMITIGR_ASSERT(number == "0");
+    }
+
+    // Limited.
+    {
+      std::istringstream in{std::string(100, 'x')};
+      fcgi::Body_spool spool;
+      bool is_thrown{};
+      try {
+        spool.append(in, 99);
+      } catch (const fcgi::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
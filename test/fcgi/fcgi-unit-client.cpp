@@ -0,0 +1,109 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+
+    const int port{9871};
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}
+      .set_max_connection_count(4)};
+    server.listen();
+    std::atomic_bool is_stopped{};
+    const auto serve = [&server, &is_stopped]
+    {
+      while (!is_stopped) {
+        if (!server.wait(std::chrono::milliseconds{50}))
+          continue;
+        const auto conn = server.accept();
+        const auto body = conn->read_body();
+        conn->out() << conn->parameter("NAME") << ":" << body;
+        if (conn->parameter_index("ERR"))
+          conn->err() << conn->parameter("ERR");
+        conn->set_application_status(static_cast<int>(body.size()));
+      }
+    };
+    std::vector<std::thread> threads(4);
+    for (auto& t : threads)
+      t = std::thread{serve};
+
+    {
+      fcgi::Client client{{"127.0.0.1", port}, 8};
+
+      // Sequential requests.
+      for (int i{}; i < 10; ++i) {
+        const auto response = client.request({{"NAME", "a"}}, "body");
+        DMITIGR_ASSERT(response.out == "a:body");
+        DMITIGR_ASSERT(response.err.empty());
+        DMITIGR_ASSERT(response.application_status == 4);
+      }
+      DMITIGR_ASSERT(!client.is_multiplexing());
+
+      // Large parameters and bodies, and the error stream.
+      {
+        const std::string name(200000, 'n');
+        const std::string body(300000, 'b');
+        const auto response = client.request({{"NAME", name}, {"ERR", "e"}},
+          body);
+        DMITIGR_ASSERT(response.out == name + ":" + body);
+        DMITIGR_ASSERT(response.err == "e");
+        DMITIGR_ASSERT(response.application_status == 300000);
+      }
+
+      // Concurrent requests.
+      {
+        std::vector<std::thread> clients(8);
+        std::atomic_int ok_count{};
+        for (std::size_t i{}; i < clients.size(); ++i) {
+          clients[i] = std::thread{[&client, &ok_count, i]
+          {
+            const auto name = std::to_string(i);
+            for (int j{}; j < 20; ++j) {
+              if (client.request({{"NAME", name}}).out == name + ":")
+                ++ok_count;
+            }
+          }};
+        }
+        for (auto& t : clients)
+          t.join();
+        DMITIGR_ASSERT(ok_count == 8 * 20);
+        DMITIGR_ASSERT(client.connection_count() <= 4); // FCGI_MAX_CONNS
+      }
+    }
+
+    is_stopped = true;
+    for (auto& t : threads)
+      t.join();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
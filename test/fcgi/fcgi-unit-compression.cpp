@@ -0,0 +1,102 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifdef DMITIGR_FCGI_ZLIB
+#include <zlib.h>
+#endif
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    using fcgi::Content_coding;
+    using fcgi::negotiate_content_coding;
+
+    // Negotiation.
+    DMITIGR_ASSERT(negotiate_content_coding("") == Content_coding::identity);
+    DMITIGR_ASSERT(negotiate_content_coding("gzip") == Content_coding::gzip);
+    DMITIGR_ASSERT(negotiate_content_coding("deflate, gzip") == Content_coding::gzip);
+    DMITIGR_ASSERT(negotiate_content_coding("deflate") == Content_coding::deflate);
+    DMITIGR_ASSERT(negotiate_content_coding("br, GZip;q=0.5, deflate;q=0.8")
+      == Content_coding::deflate);
+    DMITIGR_ASSERT(negotiate_content_coding("gzip;q=0, deflate;q=0")
+      == Content_coding::identity);
+    DMITIGR_ASSERT(negotiate_content_coding("*") == Content_coding::gzip);
+    DMITIGR_ASSERT(negotiate_content_coding("*;q=0.1, gzip;q=0")
+      == Content_coding::deflate);
+    DMITIGR_ASSERT(negotiate_content_coding("identity, br") == Content_coding::identity);
+
+#ifdef DMITIGR_FCGI_ZLIB
+    std::string body;
+    for (int i = 0; i < 100000; ++i)
+      body.append(std::to_string(i));
+
+    // Compressed.
+    for (const auto coding : {Content_coding::gzip, Content_coding::deflate}) {
+      std::ostringstream out;
+      out << "Content-Type: text/plain\r\n";
+      {
+        fcgi::Compressed_ostream stream{out, coding};
+        stream << body;
+        DMITIGR_ASSERT(stream.is_compressing());
+      }
+      const auto result = out.str();
+      const std::string headers{std::string{"Content-Type: text/plain\r\n"
+        "Content-Encoding: "}.append(fcgi::to_literal(coding))
+        .append("\r\nVary: Accept-Encoding\r\n\r\n")};
+      DMITIGR_ASSERT(result.compare(0, headers.size(), headers) == 0);
+
+      z_stream z{};
+      DMITIGR_ASSERT(inflateInit2(&z, 15 + 32) == Z_OK);
+      std::string inflated(body.size() + 1, '\0');
+      z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(result.data()))
+        + headers.size();
+      z.avail_in = static_cast<uInt>(result.size() - headers.size());
+      z.next_out = reinterpret_cast<Bytef*>(inflated.data());
+      z.avail_out = static_cast<uInt>(inflated.size());
+      DMITIGR_ASSERT(inflate(&z, Z_FINISH) == Z_STREAM_END);
+      inflated.resize(z.total_out);
+      inflateEnd(&z);
+      DMITIGR_ASSERT(inflated == body);
+    }
+
+    // Below the threshold.
+    {
+      std::ostringstream out;
+      {
+        fcgi::Compressed_ostream stream{out, Content_coding::gzip};
+        stream << "Hello";
+        stream.finish();
+        DMITIGR_ASSERT(!stream.is_compressing());
+      }
+      DMITIGR_ASSERT(out.str() == "Vary: Accept-Encoding\r\n\r\nHello");
+    }
+#endif
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
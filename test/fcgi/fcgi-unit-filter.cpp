@@ -0,0 +1,189 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+namespace fcgi = dmitigr::fcgi;
+namespace test = dmitigr::fcgi::test;
+
+constexpr int port{9879};
+
+/**
+ * @returns The records of the request of the given `role` with the data file
+ * input `data` and the parameter `FCGI_DATA_LENGTH` of `data_length` (if any).
+ */
+std::string request(const std::string_view in, const std::string_view data,
+  const std::string_view data_length,
+  const fcgi::Role role = fcgi::Role::filter)
+{
+  test::Request result{role};
+  if (!data_length.empty())
+    result.param("FCGI_DATA_LENGTH", data_length);
+  return result.records(in, data);
+}
+
+/**
+ * @brief Sends the `message` and serves the request by `handler`.
+ *
+ * @returns The content of the output stream.
+ */
+std::string serve(fcgi::Listener& server, const std::string& message,
+  const std::function<void(fcgi::Server_connection&)>& handler)
+{
+  std::string result;
+  std::thread client{[&message, &result]
+  {
+    result = test::Response{}.read_to_end(*test::send(port, message)).out();
+  }};
+  {
+    const auto conn = server.accept();
+    handler(*conn);
+  }
+  client.join();
+  return result;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+    server.listen();
+
+    std::string data(3000000, '\0');
+    for (std::size_t i{}; i < data.size(); ++i)
+      data[i] = static_cast<char>('a' + i % 23);
+    const auto data_length = std::to_string(data.size());
+
+    // The data read as a whole, with the request body left unread.
+    DMITIGR_ASSERT(serve(server, request("body", data, data_length),
+      [&data](fcgi::Server_connection& conn)
+      {
+        DMITIGR_ASSERT(conn.read_data() == data);
+        DMITIGR_ASSERT(conn.in().eof());
+        DMITIGR_ASSERT(conn.in().stream_type() == fcgi::Stream_type::data);
+        conn.out() << "ok";
+      }) == "ok");
+
+    // The data read after the request body, without the declared length.
+    DMITIGR_ASSERT(serve(server, request("body", data, {}),
+      [&data](fcgi::Server_connection& conn)
+      {
+        DMITIGR_ASSERT(conn.read_body() == "body");
+        DMITIGR_ASSERT(conn.read_data() == data);
+        conn.out() << "ok";
+      }) == "ok");
+
+    // The data spilled to the file of the spool.
+    {
+      bool is_spilled{};
+      DMITIGR_ASSERT(serve(server, request({}, data, data_length),
+        [&data, &is_spilled](fcgi::Server_connection& conn)
+        {
+          fcgi::Body_spool spool{65536};
+          conn.read_data(spool);
+          DMITIGR_ASSERT(spool.size() == data.size());
+          DMITIGR_ASSERT(spool.view() == data);
+          is_spilled = spool.is_spilled();
+          conn.out() << "ok";
+        }) == "ok");
+#ifndef _WIN32
+      DMITIGR_ASSERT(is_spilled);
+#endif
+    }
+
+    // The data kept in memory of the spool.
+    DMITIGR_ASSERT(serve(server, request({}, data, {}),
+      [&data](fcgi::Server_connection& conn)
+      {
+        fcgi::Body_spool spool{data.size()};
+        conn.read_data(spool);
+        DMITIGR_ASSERT(!spool.is_spilled());
+        DMITIGR_ASSERT(spool.view() == data);
+        conn.out() << "ok";
+      }) == "ok");
+
+    // The declared length which exceeds the actual one enormously.
+    for (const bool is_spooled : {false, true}) {
+      DMITIGR_ASSERT(serve(server, request({}, data, "100000000000"),
+        [&data, is_spooled](fcgi::Server_connection& conn)
+        {
+          if (is_spooled) {
+            fcgi::Body_spool spool;
+            conn.read_data(spool);
+            DMITIGR_ASSERT(spool.view() == data);
+          } else
+            DMITIGR_ASSERT(conn.read_data() == data);
+          conn.out() << "ok";
+        }) == "ok");
+    }
+
+    // Too large data.
+    for (const auto& length : {data_length, std::string{}}) {
+      DMITIGR_ASSERT(serve(server, request({}, data, length),
+        [](fcgi::Server_connection& conn)
+        {
+          bool is_thrown{};
+          try {
+            conn.read_data(1000);
+          } catch (const fcgi::Exception&) {
+            is_thrown = true;
+          }
+          DMITIGR_ASSERT(is_thrown);
+
+          is_thrown = false;
+          try {
+            fcgi::Body_spool spool;
+            conn.read_data(spool, 1000);
+          } catch (const fcgi::Exception&) {
+            is_thrown = true;
+          }
+          DMITIGR_ASSERT(is_thrown);
+          conn.out() << "ok";
+        }) == "ok");
+    }
+
+    // Non-filter request.
+    DMITIGR_ASSERT(serve(server, request("body", {}, {}, fcgi::Role::responder),
+      [](fcgi::Server_connection& conn)
+      {
+        bool is_thrown{};
+        try {
+          conn.read_data();
+        } catch (const fcgi::Exception&) {
+          is_thrown = true;
+        }
+        DMITIGR_ASSERT(is_thrown);
+        DMITIGR_ASSERT(conn.read_body() == "body");
+        conn.out() << "ok";
+      }) == "ok");
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
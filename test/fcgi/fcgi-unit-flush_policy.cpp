@@ -0,0 +1,200 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+namespace fcgi = dmitigr::fcgi;
+namespace test = dmitigr::fcgi::test;
+using std::chrono::milliseconds;
+
+constexpr int port{9883};
+
+/// The client which receives the output stream of the Responder.
+class Client final {
+public:
+  /// Sends the request and starts receiving the response.
+  Client()
+    : thread_{[this]
+    {
+      const auto io = test::send(port, test::Request{}.records());
+      char buf[4096];
+      while (true) {
+        {
+          const std::lock_guard lg{mutex_};
+          if (response_.is_end())
+            break;
+        }
+        const auto count = io->read(buf, sizeof(buf));
+        DMITIGR_ASSERT(count > 0);
+        const std::lock_guard lg{mutex_};
+        response_.parse(buf, static_cast<std::size_t>(count));
+        if (first_out_.empty())
+          first_out_ = response_.out();
+        condition_.notify_all();
+      }
+    }}
+  {}
+
+  /// Waits for the end of the response.
+  ~Client()
+  {
+    thread_.join();
+  }
+
+  /**
+   * @returns `true` if at least `size` bytes of the output stream are
+   * received within the `timeout`.
+   */
+  bool wait(const std::size_t size, const milliseconds timeout)
+  {
+    std::unique_lock lk{mutex_};
+    return condition_.wait_for(lk, timeout, [this, size]
+    {
+      return response_.out().size() >= size;
+    });
+  }
+
+  /// @returns The output stream received so far.
+  std::string out()
+  {
+    const std::lock_guard lg{mutex_};
+    return response_.out();
+  }
+
+  /// @returns The part of the output stream received by the first read.
+  std::string first_out()
+  {
+    const std::lock_guard lg{mutex_};
+    return first_out_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  test::Response response_;
+  std::string first_out_;
+  std::thread thread_;
+};
+
+/// Serves a request by `handler` with the given flush `policy`.
+void serve(fcgi::Listener& server, const fcgi::Flush_policy& policy,
+  const std::function<void(fcgi::Server_connection&, Client&)>& handler)
+{
+  Client client;
+  const auto conn = server.accept();
+  conn->set_flush_policy(policy);
+  handler(*conn, client);
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const milliseconds short_timeout{200};
+    const milliseconds long_timeout{5000};
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+    server.listen();
+
+    // No automatic flushing.
+    serve(server, fcgi::Flush_policy{}, [&](auto& conn, auto& client)
+    {
+      conn.out() << "a";
+      DMITIGR_ASSERT(!client.wait(1, short_timeout));
+      conn.out().flush();
+      DMITIGR_ASSERT(client.wait(1, long_timeout));
+    });
+
+    // Byte threshold.
+    serve(server, fcgi::Flush_policy{}.set_byte_threshold(100),
+      [&](auto& conn, auto& client)
+      {
+        conn.out() << std::string(50, 'a');
+        DMITIGR_ASSERT(!client.wait(1, short_timeout));
+        conn.out() << std::string(60, 'b');
+        DMITIGR_ASSERT(client.wait(100, long_timeout));
+        DMITIGR_ASSERT(client.out().compare(0, 50, std::string(50, 'a')) == 0);
+      });
+
+    // Time threshold.
+    serve(server, fcgi::Flush_policy{}.set_time_threshold(milliseconds{20}),
+      [&](auto& conn, auto& client)
+      {
+        for (const std::string_view str : {"a", "bc"}) {
+          const auto size = client.out().size();
+          conn.out() << str;
+          DMITIGR_ASSERT(client.wait(size + str.size(), long_timeout));
+        }
+        DMITIGR_ASSERT(client.out() == "abc");
+      });
+
+    // Flush after the header block.
+    serve(server, fcgi::Flush_policy{}.set_flush_after_headers(true),
+      [&](auto& conn, auto& client)
+      {
+        const std::string_view headers{"Status: 200\r\nA: b\r\n\r\n"};
+        conn.out() << headers.substr(0, 10);
+        DMITIGR_ASSERT(!client.wait(1, short_timeout));
+        conn.out() << headers.substr(10) << "body";
+        DMITIGR_ASSERT(client.wait(headers.size(), long_timeout));
+        DMITIGR_ASSERT(client.out() == headers);
+        DMITIGR_ASSERT(!client.wait(headers.size() + 1, short_timeout));
+      });
+
+    // Coalescing until the limit is reached.
+    serve(server, fcgi::Flush_policy{}.set_coalescing_limit(32),
+      [&](auto& conn, auto& client)
+      {
+        conn.out() << "a" << std::flush;
+        DMITIGR_ASSERT(!client.wait(1, short_timeout));
+        conn.out() << "b" << std::flush; // two records of 16 bytes
+        DMITIGR_ASSERT(client.wait(2, long_timeout));
+        DMITIGR_ASSERT(client.first_out() == "ab");
+      });
+
+    // Coalescing until the interval is expired.
+    serve(server, fcgi::Flush_policy{}.set_coalescing_limit(1024)
+      .set_coalescing_interval(milliseconds{1000}),
+      [&](auto& conn, auto& client)
+      {
+        conn.out() << "a" << std::flush;
+        conn.out() << "b" << std::flush;
+        DMITIGR_ASSERT(!client.wait(1, short_timeout));
+        DMITIGR_ASSERT(client.wait(2, long_timeout));
+        DMITIGR_ASSERT(client.first_out() == "ab");
+        conn.out() << "c" << std::flush;
+        DMITIGR_ASSERT(client.wait(3, long_timeout));
+        DMITIGR_ASSERT(client.out() == "abc");
+      });
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,80 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <iostream>
+#include <string>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+
+    // Empty.
+    {
+      const fcgi::Form_fields fields{""};
+      DMITIGR_ASSERT(fields.is_empty());
+      DMITIGR_ASSERT(fields.begin() == fields.end());
+      DMITIGR_ASSERT(!fields.value("a"));
+    }
+
+    // Views and decoding.
+    {
+      const std::string_view data{"q=search+engine&&page=2&flag&"
+        "name%3D=%E2%9C%93%zz%4&q=last&empty="};
+      const fcgi::Form_fields fields{data};
+      DMITIGR_ASSERT(fields.field_count() == 6);
+      DMITIGR_ASSERT(fields.field(0).name == "q");
+      DMITIGR_ASSERT(fields.field(0).value == "search engine");
+      DMITIGR_ASSERT(fields.value("page") == "2");
+      DMITIGR_ASSERT(fields.value("page")->data() == data.data() + 22);
+      DMITIGR_ASSERT(fields.value("flag") == "");
+      DMITIGR_ASSERT(fields.value("name=") == "\xE2\x9C\x93%zz%4");
+      DMITIGR_ASSERT(fields.value("q") == "search engine");
+      DMITIGR_ASSERT(fields.field_index("q", 1) == 4);
+      DMITIGR_ASSERT(fields.field(4).value == "last");
+      DMITIGR_ASSERT(!fields.field_index("q", 5));
+      DMITIGR_ASSERT(fields.value("empty") == "");
+      DMITIGR_ASSERT(!fields.value("none"));
+    }
+
+    // Many fields.
+    {
+      std::string data;
+      for (int i = 0; i < 100; ++i)
+        data.append("f").append(std::to_string(i)).append("=v+")
+          .append(std::to_string(i)).append("&");
+      fcgi::Form_fields fields{data};
+      const fcgi::Form_fields moved{std::move(fields)};
+      DMITIGR_ASSERT(moved.field_count() == 100);
+      std::size_t i{};
+      for (const auto& field : moved) {
+        DMITIGR_ASSERT(field.name == "f" + std::to_string(i));
+        DMITIGR_ASSERT(field.value == "v " + std::to_string(i));
+        ++i;
+      }
+      DMITIGR_ASSERT(moved.value("f99") == "v 99");
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
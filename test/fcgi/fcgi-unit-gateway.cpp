@@ -0,0 +1,230 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    namespace test = dmitigr::fcgi::test;
+
+    std::atomic_bool is_stopped{};
+    const auto serve = [&is_stopped](fcgi::Listener& server,
+      const std::function<void(fcgi::Server_connection&)>& handle)
+    {
+      while (!is_stopped) {
+        if (!server.wait(std::chrono::milliseconds{50}))
+          continue;
+        const auto conn = server.accept();
+        handle(*conn);
+      }
+    };
+
+    // The backends.
+    const int backend_ports[]{9872, 9873};
+    std::vector<std::unique_ptr<fcgi::Listener>> backends;
+    std::vector<std::thread> threads;
+    for (const int port : backend_ports) {
+      auto& backend = *backends.emplace_back(std::make_unique<fcgi::Listener>(
+          fcgi::Listener_options{"127.0.0.1", port, 64}));
+      backend.listen();
+      for (int i{}; i < 2; ++i) {
+        threads.emplace_back(serve, std::ref(backend),
+          [](fcgi::Server_connection& conn)
+          {
+            const auto body = conn.read_body();
+            conn.out() << conn.parameter("NAME") << ":" << body;
+            if (conn.parameter_index("ERR"))
+              conn.err() << conn.parameter("ERR");
+            conn.set_application_status(static_cast<int>(body.size()));
+          });
+      }
+    }
+
+    // The gateway.
+    const int port{9874};
+    fcgi::Gateway gateway{{{"127.0.0.1", backend_ports[0]},
+      {"127.0.0.1", backend_ports[1]}}, 2};
+    DMITIGR_ASSERT(gateway.backend_count() == 2);
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}
+      .set_max_connection_count(4)};
+    server.listen();
+    for (int i{}; i < 4; ++i) {
+      threads.emplace_back(serve, std::ref(server),
+        [&gateway](fcgi::Server_connection& conn)
+        {
+          conn.out() << "gateway:";
+          gateway.forward(conn);
+        });
+    }
+
+    {
+      fcgi::Client client{{"127.0.0.1", port}, 4};
+
+      // Sequential requests.
+      for (int i{}; i < 10; ++i) {
+        const auto response = client.request({{"NAME", "a"}}, "body");
+        DMITIGR_ASSERT(response.out == "gateway:a:body");
+        DMITIGR_ASSERT(response.err.empty());
+        DMITIGR_ASSERT(response.application_status == 4);
+      }
+
+      // Large parameters and bodies (relayed by splice), and the error stream.
+      {
+        const std::string name(200000, 'n');
+        std::string body(300000, '\0');
+        for (std::size_t i{}; i < body.size(); ++i)
+          body[i] = static_cast<char>(i % 251);
+        const auto response = client.request({{"NAME", name}, {"ERR", "e"}},
+          body);
+        DMITIGR_ASSERT(response.out == "gateway:" + name + ":" + body);
+        DMITIGR_ASSERT(response.err == "e");
+        DMITIGR_ASSERT(response.application_status == 300000);
+      }
+
+      // Concurrent requests.
+      {
+        std::vector<std::thread> clients(8);
+        std::atomic_int ok_count{};
+        for (std::size_t i{}; i < clients.size(); ++i) {
+          clients[i] = std::thread{[&client, &ok_count, i]
+          {
+            const auto name = std::to_string(i);
+            const std::string body(i * 10000, 'b');
+            for (int j{}; j < 20; ++j) {
+              if (client.request({{"NAME", name}}, body).out ==
+                "gateway:" + name + ":" + body)
+                ++ok_count;
+            }
+          }};
+        }
+        for (auto& t : clients)
+          t.join();
+        DMITIGR_ASSERT(ok_count == 8 * 20);
+      }
+    }
+    for (std::size_t i{}; i < gateway.backend_count(); ++i)
+      DMITIGR_ASSERT(!gateway.outstanding_request_count(i));
+
+    /*
+     * The front client disconnects amid the relay of the large response, and
+     * the next response relayed by the same thread must be intact.
+     */
+    {
+      const auto serve_safely = [&is_stopped](fcgi::Listener& server,
+        const std::function<void(fcgi::Server_connection&)>& handle)
+      {
+        while (!is_stopped) {
+          if (!server.wait(std::chrono::milliseconds{50}))
+            continue;
+          try {
+            const auto conn = server.accept();
+            handle(*conn);
+          } catch (const std::exception&) {}
+        }
+      };
+
+      const int backend_port{9880};
+      fcgi::Listener backend{fcgi::Listener_options{"127.0.0.1", backend_port, 64}};
+      backend.listen();
+      std::thread backend_thread{serve_safely, std::ref(backend),
+        [](fcgi::Server_connection& conn)
+        {
+          const auto size = std::stoul(std::string{conn.parameter("SIZE")});
+          const std::string chunk(65536, 'x');
+          for (std::size_t i{}; i < size; i += chunk.size())
+            conn.out().write(chunk.data(), static_cast<std::streamsize>(
+              std::min(chunk.size(), size - i)));
+        }};
+
+      const int front_port{9881};
+      fcgi::Gateway front_gateway{{{"127.0.0.1", backend_port}}, 1};
+      fcgi::Listener front{fcgi::Listener_options{"127.0.0.1", front_port, 64}};
+      front.listen();
+      std::atomic_int failure_count{};
+      std::thread front_thread{serve_safely, std::ref(front),
+        [&front_gateway, &failure_count](fcgi::Server_connection& conn)
+        {
+          try {
+            front_gateway.forward(conn);
+          } catch (...) {
+            ++failure_count;
+            throw;
+          }
+        }};
+
+      // The request of the response of 32 MB, abandoned after 1 KB.
+      {
+        const auto io = test::send(front_port,
+          test::Request{}.param("SIZE", "33554432").records());
+        char buf[1024];
+        std::size_t size{};
+        while (size < sizeof(buf)) {
+          const auto count = io->read(buf, sizeof(buf));
+          DMITIGR_ASSERT(count > 0);
+          size += static_cast<std::size_t>(count);
+        }
+
+        // Resetting the connection with the rest of the response unread.
+        const auto fd = static_cast<int>(io->native_handle());
+        const ::linger lin{1, 0};
+        DMITIGR_ASSERT(!::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin)));
+        DMITIGR_ASSERT(!::shutdown(fd, SHUT_RDWR));
+      }
+      for (int i{}; i < 100 && !failure_count; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+      DMITIGR_ASSERT(failure_count == 1);
+
+      // The next request is served by the same thread.
+      {
+        fcgi::Client client{{"127.0.0.1", front_port}, 1};
+        for (const std::size_t size : {100000, 1000000}) {
+          const auto response = client.request({{"SIZE", std::to_string(size)}});
+          DMITIGR_ASSERT(response.out == std::string(size, 'x'));
+          DMITIGR_ASSERT(response.err.empty());
+        }
+      }
+
+      is_stopped = true;
+      front_thread.join();
+      backend_thread.join();
+    }
+
+    is_stopped = true;
+    for (auto& t : threads)
+      t.join();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
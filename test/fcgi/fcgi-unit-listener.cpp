@@ -0,0 +1,182 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+
+namespace fcgi = dmitigr::fcgi;
+namespace test = dmitigr::fcgi::test;
+
+/**
+ * @brief Sends the request of the Responder and receives the response.
+ *
+ * @details If `is_released` is specified, the connection is kept by the client
+ * (i.e. is neither read nor closed) after the response until `*is_released`,
+ * and then it must be found closed by the server.
+ *
+ * @returns The protocol status of the end-request record.
+ */
+int request(const int port, const std::atomic_bool* const is_released = nullptr)
+{
+  const auto io = test::send(port,
+    test::Request{fcgi::Role::responder, is_released != nullptr}
+    .param("NAME", {}).records("input"));
+  test::Response response;
+  response.read_to_end(*io);
+  if (is_released) {
+    while (!*is_released)
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    DMITIGR_ASSERT(!response.read(*io));
+  }
+  return response.protocol_status();
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // Options.
+    {
+      fcgi::Listener_options options{"127.0.0.1", 9877, 64};
+      DMITIGR_ASSERT(!options.max_in_flight_request_count());
+      options.set_max_in_flight_request_count(2);
+      DMITIGR_ASSERT(options.max_in_flight_request_count() == 2);
+      DMITIGR_ASSERT(options.max_concurrent_request_count() == 1);
+      options.set_max_connection_count(8);
+      DMITIGR_ASSERT(options.max_concurrent_request_count() == 2);
+      options.set_max_in_flight_request_count(std::nullopt);
+      DMITIGR_ASSERT(options.max_concurrent_request_count() == 8);
+      bool is_thrown{};
+      try {
+        options.set_max_in_flight_request_count(0);
+      } catch (const fcgi::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+    }
+
+    // Admission control.
+    {
+      const int port{9877};
+      fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}
+        .set_max_in_flight_request_count(1)};
+      server.listen();
+      DMITIGR_ASSERT(!server.in_flight_request_count());
+
+      // The first request is accepted and is in progress.
+      int first_status{-1};
+      std::thread first{[&]{first_status = request(port);}};
+      auto conn = server.accept();
+      DMITIGR_ASSERT(conn);
+      DMITIGR_ASSERT(server.in_flight_request_count() == 1);
+
+      // The second request is rejected.
+      int second_status{-1};
+      std::thread second{[&]{second_status = request(port);}};
+      DMITIGR_ASSERT(!server.accept());
+      second.join();
+      DMITIGR_ASSERT(second_status == 2); // FCGI_OVERLOADED
+      DMITIGR_ASSERT(server.in_flight_request_count() == 1);
+
+      // The first request is completed.
+      DMITIGR_ASSERT(conn->parameter("NAME").empty());
+      DMITIGR_ASSERT(conn->read_body() == "input");
+      conn->out() << "output";
+      conn.reset();
+      first.join();
+      DMITIGR_ASSERT(first_status == 0); // FCGI_REQUEST_COMPLETE
+      DMITIGR_ASSERT(!server.in_flight_request_count());
+
+      // The third request is accepted.
+      int third_status{-1};
+      std::thread third{[&]{third_status = request(port);}};
+      conn = server.accept();
+      DMITIGR_ASSERT(conn);
+      conn.reset();
+      third.join();
+      DMITIGR_ASSERT(third_status == 0);
+
+      /*
+       * The request is rejected promptly even though the client keeps the
+       * connection.
+       */
+      std::thread fourth{[&]{request(port);}};
+      conn = server.accept();
+      DMITIGR_ASSERT(conn);
+      int kept_status{-1};
+      std::atomic_bool is_released{};
+      std::thread kept{[&]
+      {
+        kept_status = request(port, &is_released);
+      }};
+      const auto started = std::chrono::steady_clock::now();
+      DMITIGR_ASSERT(!server.accept());
+      DMITIGR_ASSERT(std::chrono::steady_clock::now() - started <
+        std::chrono::milliseconds{500});
+      is_released = true;
+      kept.join();
+      DMITIGR_ASSERT(kept_status == 2);
+      conn.reset();
+      fourth.join();
+    }
+
+    /*
+     * The capacity reported in reply to the get-values records, both the one
+     * which precedes the request and the one within the request, is limited
+     * by the maximum number of requests in progress.
+     */
+    {
+      const int port{9887};
+      fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}
+        .set_max_connection_count(8).set_max_in_flight_request_count(2)};
+      server.listen();
+      std::thread client{[port]
+      {
+        const std::string get_values{"\x0e\x00" "FCGI_MAX_CONNS"
+          "\x0d\x00" "FCGI_MAX_REQS", 31};
+        const auto io = test::send(port, test::record(9, get_values, 0) +
+          test::Request{}.begin() + test::record(9, get_values, 0) +
+          test::record(5));
+        const auto get_values_result = test::record(10, {"\x0e\x01"
+          "FCGI_MAX_CONNS" "2" "\x0d\x01" "FCGI_MAX_REQS" "2", 33}, 0);
+        test::Response response;
+        const auto& records = response.read_to_end(*io).management_records();
+        DMITIGR_ASSERT(records.size() == 2);
+        for (const auto& record : records)
+          DMITIGR_ASSERT(record == get_values_result);
+      }};
+      const auto conn = server.accept();
+      DMITIGR_ASSERT(conn);
+      DMITIGR_ASSERT(conn->read_body().empty());
+      conn->close();
+      client.join();
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,148 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+
+    // Boundary.
+    {
+      using fcgi::multipart_boundary;
+      DMITIGR_ASSERT(multipart_boundary("multipart/form-data; boundary=abc") == "abc");
+      DMITIGR_ASSERT(multipart_boundary("Multipart/Form-Data;charset=utf-8;"
+          " Boundary=\"a b;c\"") == "a b;c");
+      DMITIGR_ASSERT(!multipart_boundary("multipart/form-data"));
+      DMITIGR_ASSERT(!multipart_boundary("text/plain; boundary=abc"));
+    }
+
+    // Parts.
+    {
+      std::string file(100000, '\0');
+      for (std::size_t i{}; i < file.size(); ++i)
+        file[i] = "ab\r\n--XY\r\n-\r\0"[i % 13]; // delimiter prefixes
+
+      const std::string body = "preamble\r\n"
+        "--XYZ\r\n"
+        "Content-Disposition: form-data; name=\"text\"\r\n"
+        "\r\n"
+        "Hello, World!\r\n"
+        "--XYZ  \r\n"
+        "content-disposition: form-data; name=\"file\"; filename=\"f.bin\"\r\n"
+        "Content-Type: application/octet-stream\r\n"
+        "\r\n" + file + "\r\n"
+        "--XYZ\r\n"
+        "\r\n"
+        "\r\n"
+        "--XYZ--\r\n"
+        "epilogue";
+
+      for (const std::size_t chunk_size : {1, 2, 7, 64, 4096, 1000000}) {
+        struct Part final {
+          std::string name;
+          std::string filename;
+          std::string content_type;
+          std::string data;
+          bool is_complete{};
+        };
+        std::vector<Part> parts;
+        fcgi::Multipart_parser parser{"XYZ"};
+        parser.set_part_handler([&parts](const fcgi::Multipart_part& part)
+        {
+          parts.push_back({std::string{part.name()},
+            std::string{part.filename().value_or("")},
+            std::string{part.content_type()}, {}, false});
+        }).set_data_handler([&parts](const std::string_view data)
+        {
+          DMITIGR_ASSERT(!data.empty());
+          parts.back().data.append(data);
+        }).set_part_end_handler([&parts]
+        {
+          parts.back().is_complete = true;
+        });
+
+        for (std::size_t i{}; i < body.size(); i += chunk_size)
+          parser.parse(body.data() + i, std::min(chunk_size, body.size() - i));
+        DMITIGR_ASSERT(parser.is_done());
+
+        DMITIGR_ASSERT(parts.size() == 3);
+        DMITIGR_ASSERT(parts[0].name == "text");
+        DMITIGR_ASSERT(parts[0].filename.empty());
+        DMITIGR_ASSERT(parts[0].content_type == "text/plain");
+        DMITIGR_ASSERT(parts[0].data == "Hello, World!");
+        DMITIGR_ASSERT(parts[1].name == "file");
+        DMITIGR_ASSERT(parts[1].filename == "f.bin");
+        DMITIGR_ASSERT(parts[1].content_type == "application/octet-stream");
+        DMITIGR_ASSERT(parts[1].data == file);
+        DMITIGR_ASSERT(parts[2].name.empty());
+        DMITIGR_ASSERT(parts[2].data.empty());
+        for (const auto& part : parts)
+          DMITIGR_ASSERT(part.is_complete);
+      }
+    }
+
+    // Stream.
+    {
+      std::istringstream in{"--B\r\nA: 1\r\n\r\nx\r\n--B--"};
+      std::string data;
+      fcgi::Multipart_parser parser{"B"};
+      parser.set_part_handler([](const fcgi::Multipart_part& part)
+      {
+        DMITIGR_ASSERT(part.header_count() == 1);
+        DMITIGR_ASSERT(part.header("a") == "1");
+        DMITIGR_ASSERT(!part.header("b"));
+      }).set_data_handler([&data](const std::string_view d){data.append(d);});
+      parser.parse(in);
+      DMITIGR_ASSERT(parser.is_done());
+      DMITIGR_ASSERT(data == "x");
+    }
+
+    // Errors.
+    {
+      bool is_thrown{};
+      try {
+        std::istringstream in{"--B\r\n\r\nx"};
+        fcgi::Multipart_parser{"B"}.parse(in);
+      } catch (const fcgi::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+
+      is_thrown = false;
+      try {
+        const std::string body{"--B\r\n" + std::string(20000, 'h')};
+        fcgi::Multipart_parser{"B"}.parse(body.data(), body.size());
+      } catch (const fcgi::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
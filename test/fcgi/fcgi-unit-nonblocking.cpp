@@ -0,0 +1,93 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    namespace test = dmitigr::fcgi::test;
+    using std::chrono::milliseconds;
+
+    const int port{9884};
+    fcgi::Listener_options options{"127.0.0.1", port, 64};
+    options.set_nonblocking(true);
+
+    // Backpressure upon exceeding the backlog limit.
+    {
+      options.set_output_backlog_limit(65536);
+      fcgi::Listener server{options};
+      server.listen();
+
+      constexpr std::size_t size{67108864};
+      std::atomic_size_t written{};
+      const auto io = test::send(port, test::Request{}.records());
+      std::thread handler{[&server, &written]
+      {
+        const auto conn = server.accept();
+        test::write_sample(conn->out(), size, written);
+      }};
+
+      // The handler must stall while the client is not reading.
+      std::size_t stalled{};
+      for (int i{}; i < 100 && written != stalled; ++i) {
+        stalled = written;
+        std::this_thread::sleep_for(milliseconds{300});
+      }
+      DMITIGR_ASSERT(written == stalled && stalled < size);
+
+      DMITIGR_ASSERT(test::Response{}.read_to_end(*io).out() ==
+        test::sample(0, size));
+      handler.join();
+    }
+
+    // The backlog is drained upon closing.
+    {
+      options.set_output_backlog_limit(67108864);
+      fcgi::Listener server{options};
+      server.listen();
+
+      constexpr std::size_t size{33554432};
+      const auto io = test::send(port, test::Request{}.records());
+      std::atomic_bool is_closed{};
+      std::thread handler{[&server, &is_closed]
+      {
+        const auto conn = server.accept();
+        test::write_sample(conn->out(), size); // mostly into the backlog
+        conn->close();
+        is_closed = true;
+      }};
+      std::this_thread::sleep_for(milliseconds{500});
+      DMITIGR_ASSERT(!is_closed);
+      DMITIGR_ASSERT(test::Response{}.read_to_end(*io).out() ==
+        test::sample(0, size));
+      handler.join();
+      DMITIGR_ASSERT(is_closed);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,123 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+namespace fcgi = dmitigr::fcgi;
+namespace net = dmitigr::net;
+namespace test = dmitigr::fcgi::test;
+using Clock = std::chrono::steady_clock;
+
+/// @returns `true` if the `policy` is supported by the platform.
+bool is_supported(const net::Output_policy policy) noexcept
+{
+  switch (policy) {
+  case net::Output_policy::immediate:
+    return true;
+  case net::Output_policy::msg_more:
+#ifdef MSG_MORE
+    return true;
+#else
+    return false;
+#endif
+  case net::Output_policy::cork:
+    return net::is_tcp_cork_supported();
+  }
+  return false;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    using net::Output_policy;
+    const int port{9886};
+    const auto expected = test::sample(0, 200000);
+    for (const auto policy : {Output_policy::immediate,
+        Output_policy::msg_more, Output_policy::cork}) {
+      fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}
+        .set_output_policy(policy)};
+      server.listen();
+
+      std::optional<Clock::time_point> end_time;
+      test::Response response;
+      std::atomic_size_t out_size{};
+      std::thread client{[&end_time, &response, &out_size, port]
+      {
+        const auto io = test::send(port, test::Request{}.records());
+        while (!response.is_end() && response.read(*io))
+          out_size = response.out().size();
+        if (response.is_end())
+          end_time = Clock::now();
+      }};
+
+      if (!is_supported(policy)) {
+        bool is_rejected{};
+        try {
+          server.accept();
+        } catch (const std::exception&) {
+          is_rejected = true;
+        }
+        client.join();
+        DMITIGR_ASSERT(is_rejected && !end_time);
+        continue;
+      }
+
+      /*
+       * The intermediate records are deferred, but the output must be
+       * transmitted completely upon the explicit flush and upon closing
+       * without waiting for the kernel to push the pending partial frame
+       * (which takes up to 200 ms).
+       */
+      const std::chrono::milliseconds timeout{150};
+      const std::string_view tail{"tail"};
+      Clock::time_point close_time;
+      {
+        const auto conn = server.accept();
+        conn->out() << expected << std::flush;
+        const auto flush_time = Clock::now();
+        while (out_size < expected.size() && Clock::now() - flush_time < timeout)
+          std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        DMITIGR_ASSERT(out_size == expected.size());
+
+        conn->out() << tail;
+        close_time = Clock::now();
+        conn->close();
+      }
+      client.join();
+      DMITIGR_ASSERT(response.out() == expected + tail.data());
+      DMITIGR_ASSERT(end_time);
+      DMITIGR_ASSERT(*end_time - close_time < timeout);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,88 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+/// @returns The concatenated content of the records of type `out`.
+std::string parse(std::string_view data, bool& is_end)
+{
+  std::string result;
+  is_end = false;
+  while (!data.empty()) {
+    DMITIGR_ASSERT(data.size() >= 8 && !is_end);
+    const auto byte = [&data](const std::size_t i)
+    {
+      return static_cast<unsigned char>(data[i]);
+    };
+    DMITIGR_ASSERT(byte(0) == 1); // version
+    DMITIGR_ASSERT((byte(2) << 8 | byte(3)) == 1); // request id
+    const std::size_t content_length = byte(4) << 8 | byte(5);
+    const std::size_t padding_length = byte(6);
+    DMITIGR_ASSERT((content_length + padding_length) % 8 == 0);
+    if (byte(1) == 6)
+      result.append(data.substr(8, content_length));
+    else {
+      DMITIGR_ASSERT(byte(1) == 3 && content_length == 8); // end request
+      is_end = true;
+    }
+    data.remove_prefix(8 + content_length + padding_length);
+  }
+  return result;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+
+    for (const std::size_t size : {0, 1, 8, 65527, 65528, 65529, 200000}) {
+      std::string content(size, '\0');
+      for (std::size_t i{}; i < size; ++i)
+        content[i] = static_cast<char>('a' + i % 26);
+      const fcgi::Prepared_response response{content};
+      DMITIGR_ASSERT(response.content_size() == size);
+      DMITIGR_ASSERT(response.data().size() % 8 == 0);
+      bool is_end{};
+      DMITIGR_ASSERT(parse(response.data(), is_end) == content);
+      DMITIGR_ASSERT(is_end);
+    }
+
+    {
+      const fcgi::Prepared_response response{
+        fcgi::Response_headers{404}.append_content_length(2), "No"};
+      bool is_end{};
+      DMITIGR_ASSERT(parse(response.data(), is_end) ==
+        "Status: 404 Not Found\r\nContent-Length: 2\r\n\r\nNo");
+      DMITIGR_ASSERT(is_end);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
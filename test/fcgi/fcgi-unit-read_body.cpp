@@ -0,0 +1,137 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+namespace fcgi = dmitigr::fcgi;
+namespace test = dmitigr::fcgi::test;
+
+constexpr int port{9882};
+
+/**
+ * @returns The records of the request of the Responder with the `body` and
+ * the parameter `CONTENT_LENGTH` of `content_length` (if any).
+ */
+std::string request(const std::string_view body,
+  const std::optional<std::string_view> content_length)
+{
+  test::Request result;
+  if (content_length)
+    result.param("CONTENT_LENGTH", *content_length);
+  return result.records(body);
+}
+
+/// Sends the `message` and serves the request by `handler`.
+void serve(fcgi::Listener& server, const std::string& message,
+  const std::function<void(fcgi::Server_connection&)>& handler)
+{
+  std::thread client{[&message]
+  {
+    test::Response{}.read_to_end(*test::send(port, message));
+  }};
+  {
+    const auto conn = server.accept();
+    handler(*conn);
+  }
+  client.join();
+}
+
+/// @returns `true` if `read_body(max_size)` of `conn` throws.
+bool is_read_body_thrown(fcgi::Server_connection& conn,
+  const std::optional<std::size_t> max_size)
+{
+  try {
+    conn.read_body(max_size);
+  } catch (const fcgi::Exception&) {
+    return true;
+  }
+  return false;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+    server.listen();
+
+    std::string body(1000000, '\0');
+    for (std::size_t i{}; i < body.size(); ++i)
+      body[i] = static_cast<char>('a' + i % 23);
+    const auto content_length = std::to_string(body.size());
+
+    // The declared length, with and without the maximum size.
+    for (const auto max_size : {std::optional<std::size_t>{},
+        std::optional<std::size_t>{body.size()}}) {
+      serve(server, request(body, content_length),
+        [&body, max_size](fcgi::Server_connection& conn)
+        {
+          DMITIGR_ASSERT(conn.read_body(max_size) == body);
+          DMITIGR_ASSERT(conn.in().eof());
+        });
+    }
+
+    // No declared length.
+    serve(server, request(body, std::nullopt),
+      [&body](fcgi::Server_connection& conn)
+      {
+        DMITIGR_ASSERT(conn.read_body() == body);
+      });
+
+    // The declared length which doesn't match the actual one.
+    for (const auto length : {"10", "100000000000"}) {
+      serve(server, request(body, length),
+        [&body](fcgi::Server_connection& conn)
+        {
+          DMITIGR_ASSERT(conn.read_body() == body);
+        });
+    }
+
+    // The declared length exceeds the maximum size: nothing is read.
+    serve(server, request(body, content_length),
+      [&body](fcgi::Server_connection& conn)
+      {
+        DMITIGR_ASSERT(is_read_body_thrown(conn, body.size() - 1));
+        DMITIGR_ASSERT(conn.read_body() == body);
+      });
+
+    // The actual length exceeds the maximum size.
+    for (const auto& length : {std::optional<std::string_view>{},
+        std::optional<std::string_view>{"10"}}) {
+      serve(server, request(body, length),
+        [&body](fcgi::Server_connection& conn)
+        {
+          DMITIGR_ASSERT(is_read_body_thrown(conn, body.size() - 1));
+        });
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,127 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    using fcgi::Record_encoder;
+    using fcgi::Stream_type;
+
+    std::string content(150001, '\0');
+    for (std::size_t i{}; i < content.size(); ++i)
+      content[i] = static_cast<char>('a' + i % 26);
+
+    Record_encoder encoder;
+    for (int round{}; round < 2; ++round) {
+      encoder.clear();
+      DMITIGR_ASSERT(!encoder.iovec_count() && !encoder.size());
+      encoder.append_begin_request(1, fcgi::Role::responder, true)
+        .append_stream(Stream_type::params, 1, {})
+        .append_end_of_stream(Stream_type::params, 1)
+        .append_stream(Stream_type::out, 1, content)
+        .append_end_of_stream(Stream_type::out, 1)
+        .append_end_request(1, 7);
+
+      // The content is referred, not copied.
+      const auto* const iov = encoder.iovecs();
+      std::size_t content_iov_count{};
+      std::string data;
+      for (std::size_t i{}; i < encoder.iovec_count(); ++i) {
+        const auto* const base = static_cast<const char*>(iov[i].iov_base);
+        if (content.data() <= base && base < content.data() + content.size())
+          ++content_iov_count;
+        data.append(base, iov[i].iov_len);
+      }
+      DMITIGR_ASSERT(content_iov_count == 3);
+      DMITIGR_ASSERT(data.size() == encoder.size());
+      // 3 content + 1 padding + 4 headers (merged where adjacent).
+      DMITIGR_ASSERT(encoder.iovec_count() == 8);
+
+      // The iovecs can be requested again.
+      DMITIGR_ASSERT(encoder.iovecs()[1].iov_base == iov[1].iov_base);
+
+      struct Record final {
+        fcgi::Record_header header;
+        std::string content;
+      };
+      std::vector<Record> records;
+      fcgi::Record_parser parser;
+      parser.set_header_handler([&records](const fcgi::Record_header& header)
+      {
+        records.push_back({header, {}});
+      }).set_content_handler([&records](const fcgi::Record_header&,
+          const std::string_view content)
+      {
+        records.back().content.append(content);
+      });
+      parser.parse(data.data(), data.size());
+      DMITIGR_ASSERT(parser.is_record_boundary());
+
+      DMITIGR_ASSERT(records.size() == 7);
+      DMITIGR_ASSERT(records[0].header.type == 1);
+      DMITIGR_ASSERT(records[0].content.size() == 8);
+      DMITIGR_ASSERT(records[1].header.type == 4);
+      DMITIGR_ASSERT(records[1].content.empty());
+      std::string out;
+      for (std::size_t i{2}; i < 6; ++i) {
+        DMITIGR_ASSERT(records[i].header.type == 6);
+        DMITIGR_ASSERT(records[i].header.request_id == 1);
+        DMITIGR_ASSERT(records[i].header.content_length <=
+          Record_encoder::max_content_length);
+        DMITIGR_ASSERT((records[i].header.content_length +
+            records[i].header.padding_length) % 8 == 0);
+        out.append(records[i].content);
+      }
+      DMITIGR_ASSERT(out == content);
+      DMITIGR_ASSERT(records[5].content.empty());
+      DMITIGR_ASSERT(records[6].header.type == 3);
+      DMITIGR_ASSERT(records[6].content.size() == 8);
+      DMITIGR_ASSERT(records[6].content[3] == 7);
+      DMITIGR_ASSERT(records[6].content[4] == 0);
+    }
+
+    // The management and abort-request records are stored in the encoder.
+    {
+      Record_encoder encoder;
+      encoder.append_get_values({"FCGI_MAX_CONNS", "FCGI_MPXS_CONNS"})
+        .append_abort_request(3);
+      DMITIGR_ASSERT(encoder.iovec_count() == 1);
+      const auto* const iov = encoder.iovecs();
+      const std::string_view data{static_cast<const char*>(iov[0].iov_base),
+        iov[0].iov_len};
+      DMITIGR_ASSERT(data.size() == encoder.size());
+      const std::string_view expected{"\1\x09\0\0\0\x21\7\0"
+        "\x0e\0" "FCGI_MAX_CONNS" "\x0f\0" "FCGI_MPXS_CONNS" "\0\0\0\0\0\0\0"
+        "\1\2\0\3\0\0\0\0", 56};
+      DMITIGR_ASSERT(data == expected);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
@@ -0,0 +1,153 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string record(const int type, const int request_id,
+  const std::string& content, const int padding_length)
+{
+  std::string result{static_cast<char>(1), static_cast<char>(type),
+    static_cast<char>(request_id >> 8), static_cast<char>(request_id & 0xff),
+    static_cast<char>(content.size() >> 8),
+    static_cast<char>(content.size() & 0xff),
+    static_cast<char>(padding_length), '\0'};
+  result.append(content);
+  result.append(static_cast<std::size_t>(padding_length), '\0');
+  return result;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+
+    // Records.
+    {
+      std::string stdin_content(65535, '\0');
+      for (std::size_t i{}; i < stdin_content.size(); ++i)
+        stdin_content[i] = static_cast<char>('a' + i % 26);
+      const std::string get_values{"\x0e\x00MAX_CONNS", 11};
+      const std::string stream = record(1, 1, std::string{"\0\1\0\0\0\0\0\0", 8}, 0) +
+        record(9, 0, get_values, 5) +
+        record(4, 1, "params", 2) +
+        record(4, 1, "", 0) +
+        record(5, 1, stdin_content, 1) +
+        record(9, 0, "", 0) +
+        record(5, 1, "", 0);
+
+      for (const std::size_t chunk_size : {1, 2, 7, 8, 64, 4096, 1000000}) {
+        struct Record final {
+          fcgi::Record_header header;
+          std::string content;
+          bool is_complete{};
+        };
+        std::vector<Record> records;
+        std::vector<std::string> management_contents;
+        fcgi::Record_parser parser;
+        parser.set_header_handler([&records](const fcgi::Record_header& header)
+        {
+          DMITIGR_ASSERT(!header.is_management());
+          records.push_back({header, {}, false});
+        }).set_content_handler([&records](const fcgi::Record_header& header,
+            const std::string_view content)
+        {
+          DMITIGR_ASSERT(!content.empty());
+          DMITIGR_ASSERT(header.type == records.back().header.type);
+          records.back().content.append(content);
+        }).set_record_end_handler([&records](const fcgi::Record_header&)
+        {
+          records.back().is_complete = true;
+        }).set_management_handler([&](const fcgi::Record_header& header,
+            const std::string_view content)
+        {
+          DMITIGR_ASSERT(header.is_management());
+          DMITIGR_ASSERT(header.type == 9);
+          DMITIGR_ASSERT(content.size() == header.content_length);
+          management_contents.emplace_back(content);
+        });
+
+        for (std::size_t i{}; i < stream.size(); i += chunk_size)
+          parser.parse(stream.data() + i, std::min(chunk_size, stream.size() - i));
+        DMITIGR_ASSERT(parser.is_record_boundary());
+
+        DMITIGR_ASSERT(records.size() == 5);
+        DMITIGR_ASSERT(records[0].header.type == 1);
+        DMITIGR_ASSERT(records[0].header.request_id == 1);
+        DMITIGR_ASSERT(records[0].header.content_length == 8);
+        DMITIGR_ASSERT(records[1].header.type == 4);
+        DMITIGR_ASSERT(records[1].header.padding_length == 2);
+        DMITIGR_ASSERT(records[1].content == "params");
+        DMITIGR_ASSERT(records[2].content.empty());
+        DMITIGR_ASSERT(records[3].header.type == 5);
+        DMITIGR_ASSERT(records[3].header.content_length == 65535);
+        DMITIGR_ASSERT(records[3].content == stdin_content);
+        DMITIGR_ASSERT(records[4].header.content_length == 0);
+        for (const auto& rec : records)
+          DMITIGR_ASSERT(rec.is_complete);
+        DMITIGR_ASSERT(management_contents.size() == 2);
+        DMITIGR_ASSERT(management_contents[0] == get_values);
+        DMITIGR_ASSERT(management_contents[1].empty());
+      }
+    }
+
+    // Reset.
+    {
+      int header_count{};
+      fcgi::Record_parser parser;
+      parser.set_header_handler([&header_count](const fcgi::Record_header&)
+      {
+        ++header_count;
+      });
+      const std::string rec = record(5, 1, "data", 4);
+      parser.parse(rec.data(), 5);
+      DMITIGR_ASSERT(!parser.is_record_boundary());
+      parser.reset();
+      DMITIGR_ASSERT(parser.is_record_boundary());
+      parser.parse(rec.data(), rec.size());
+      DMITIGR_ASSERT(parser.is_record_boundary());
+      DMITIGR_ASSERT(header_count == 1);
+    }
+
+    // Errors.
+    {
+      bool is_thrown{};
+      try {
+        std::string rec = record(5, 1, "data", 0);
+        rec[0] = 2;
+        fcgi::Record_parser{}.parse(rec.data(), rec.size());
+      } catch (const fcgi::Exception&) {
+        is_thrown = true;
+      }
+      DMITIGR_ASSERT(is_thrown);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
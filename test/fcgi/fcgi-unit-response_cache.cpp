@@ -0,0 +1,94 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    using std::chrono::milliseconds;
+    using std::chrono::seconds;
+
+    const auto response = [](const std::string& content)
+    {
+      return std::make_shared<const fcgi::Prepared_response>(content);
+    };
+
+    // Insertion, lookup and expiration.
+    {
+      fcgi::Response_cache cache{{"REQUEST_URI"}, 1 << 20, 4};
+      DMITIGR_ASSERT(cache.parameters().size() == 1);
+      DMITIGR_ASSERT(cache.memory_limit() == 1 << 20);
+      DMITIGR_ASSERT(!cache.find("a"));
+      DMITIGR_ASSERT(cache.insert("a", response("A"), seconds{60}));
+      DMITIGR_ASSERT(cache.insert("b", response("B"), milliseconds{1}));
+      DMITIGR_ASSERT(cache.size() == 2);
+      DMITIGR_ASSERT(cache.find("a")->content_size() == 1);
+      std::this_thread::sleep_for(milliseconds{10});
+      DMITIGR_ASSERT(!cache.find("b"));
+      DMITIGR_ASSERT(cache.size() == 1);
+
+      // Replacement.
+      DMITIGR_ASSERT(cache.insert("a", response("AA"), seconds{60}));
+      DMITIGR_ASSERT(cache.size() == 1);
+      DMITIGR_ASSERT(cache.find("a")->content_size() == 2);
+      DMITIGR_ASSERT(cache.memory_usage() ==
+        1 + cache.find("a")->data().size());
+
+      DMITIGR_ASSERT(cache.erase("a"));
+      DMITIGR_ASSERT(!cache.erase("a"));
+      DMITIGR_ASSERT(!cache.size() && !cache.memory_usage());
+    }
+
+    // LRU eviction.
+    {
+      const auto size = fcgi::Prepared_response{"x"}.data().size() + 1;
+      fcgi::Response_cache cache{{}, 3 * size, 1};
+      DMITIGR_ASSERT(cache.insert("a", response("x"), seconds{60}));
+      DMITIGR_ASSERT(cache.insert("b", response("x"), seconds{60}));
+      DMITIGR_ASSERT(cache.insert("c", response("x"), seconds{60}));
+      DMITIGR_ASSERT(cache.find("a")); // "b" is the least recently used now
+      DMITIGR_ASSERT(cache.insert("d", response("x"), seconds{60}));
+      DMITIGR_ASSERT(cache.size() == 3);
+      DMITIGR_ASSERT(cache.find("a") && !cache.find("b") &&
+        cache.find("c") && cache.find("d"));
+      DMITIGR_ASSERT(cache.memory_usage() <= cache.memory_limit());
+
+      // Too large response.
+      DMITIGR_ASSERT(!cache.insert("e", response(std::string(4 * size, 'x')),
+        seconds{60}));
+      DMITIGR_ASSERT(!cache.find("e"));
+
+      cache.clear();
+      DMITIGR_ASSERT(!cache.size() && !cache.memory_usage());
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
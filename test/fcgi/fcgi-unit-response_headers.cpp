@@ -0,0 +1,124 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "fcgi-unit.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    namespace test = dmitigr::fcgi::test;
+
+    // Common status.
+    {
+      fcgi::Response_headers headers;
+      DMITIGR_ASSERT(headers.status() == 200);
+      DMITIGR_ASSERT(headers.data() == "Status: 200 OK\r\n\r\n");
+      headers.append_content_type("text/plain").append_content_length(13)
+        .append("X-Id", "1");
+      DMITIGR_ASSERT(headers.data() == "Status: 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 13\r\n"
+        "X-Id: 1\r\n"
+        "\r\n");
+      headers.set_status(404);
+      DMITIGR_ASSERT(headers.status() == 404);
+      DMITIGR_ASSERT(headers.data() == "Status: 404 Not Found\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 13\r\n"
+        "X-Id: 1\r\n"
+        "\r\n");
+
+      std::ostringstream out;
+      headers.write(out);
+      DMITIGR_ASSERT(out.str() == headers.data());
+    }
+
+    // Uncommon status and custom reason.
+    {
+      DMITIGR_ASSERT(fcgi::Response_headers{299}.data() == "Status: 299\r\n\r\n");
+      DMITIGR_ASSERT(fcgi::Response_headers(200, "Fine").data() ==
+        "Status: 200 Fine\r\n\r\n");
+    }
+
+    // Errors.
+    {
+      const auto is_thrown = [](const auto& f)
+      {
+        try {
+          f();
+        } catch (const fcgi::Exception&) {
+          return true;
+        }
+        return false;
+      };
+      fcgi::Response_headers headers;
+      DMITIGR_ASSERT(is_thrown([&]{headers.set_status(99);}));
+      DMITIGR_ASSERT(is_thrown([&]{headers.set_status(1000);}));
+      DMITIGR_ASSERT(is_thrown([&]{headers.set_status(200, "A\r\nB: c");}));
+      DMITIGR_ASSERT(is_thrown([&]{headers.append("", "v");}));
+      DMITIGR_ASSERT(is_thrown([&]{headers.append("A:", "v");}));
+      DMITIGR_ASSERT(is_thrown([&]{headers.append("A", "v\nB: c");}));
+      DMITIGR_ASSERT(headers.data() == "Status: 200 OK\r\n\r\n");
+    }
+
+    /*
+     * The header block written to the output stream of the connection is sent
+     * in the same record as the body. If the block doesn't fit in the free
+     * space of the put area, the put area is flushed before.
+     */
+    {
+      const int port{9890};
+      fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+      server.listen();
+      const std::string body{"Hello!"};
+      const auto headers = fcgi::Response_headers{}
+        .append_content_type("text/plain").append_content_length(body.size());
+      const auto block_size = headers.data().size();
+      for (const std::size_t prefix_size : {0, 65500}) {
+        const auto prefix = test::sample(0, prefix_size);
+        std::thread handler{[&]
+        {
+          const auto conn = server.accept();
+          conn->out() << prefix;
+          headers.write(conn->out());
+          conn->out() << body;
+        }};
+        test::Response response;
+        response.read_to_end(*test::send(port, test::Request{}.records()));
+        handler.join();
+        DMITIGR_ASSERT(response.out() ==
+          prefix + std::string{headers.data()} + body);
+        std::vector<std::size_t> record_sizes{block_size + body.size(), 0};
+        if (prefix_size)
+          record_sizes.insert(record_sizes.begin(), prefix_size);
+        DMITIGR_ASSERT(response.out_record_sizes() == record_sizes);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
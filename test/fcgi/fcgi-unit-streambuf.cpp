@@ -0,0 +1,121 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+namespace fcgi = dmitigr::fcgi;
+namespace net = dmitigr::net;
+
+/// @returns The record of the given `type`.
+std::string record(const int type, const int request_id,
+  const std::string_view content = {})
+{
+  const auto padding_length = (8 - content.size() % 8) % 8;
+  std::string result{'\1', static_cast<char>(type),
+    static_cast<char>(request_id >> 8), static_cast<char>(request_id),
+    static_cast<char>(content.size() >> 8), static_cast<char>(content.size()),
+    static_cast<char>(padding_length), '\0'};
+  result.append(content).append(padding_length, '\0');
+  return result;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const int port{9876};
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+    server.listen();
+
+    /*
+     * The input of many records of various sizes interleaved with the
+     * management records and the records of other requests, written in
+     * chunks which split the records.
+     */
+    std::string input;
+    std::string message{record(1, 1, {"\0\1\0\0\0\0\0\0", 8}) + record(4, 1)};
+    const std::string get_values{"\x0e\x00" "FCGI_MAX_CONNS", 16};
+    for (std::size_t i{}; i < 3000; ++i) {
+      const std::string content(1 + i * 7919 % 300, static_cast<char>('a' + i % 26));
+      input.append(content);
+      message.append(record(5, 1, content));
+      if (i % 100 == 0)
+        message.append(record(9, 0, get_values)).append(record(6, 2, "zz"));
+    }
+    message.append(record(5, 1));
+
+    std::thread client{[&message, port]
+    {
+      const auto io = net::make_tcp_connection({"127.0.0.1", port});
+      for (std::size_t i{}; i < message.size(); i += 1000)
+        net::write_all(*io, message.data() + i, static_cast<std::streamsize>(
+          std::min<std::size_t>(1000, message.size() - i)));
+
+      // Reading the response until the end-request record.
+      std::string response;
+      fcgi::Record_parser parser;
+      int get_values_result_count{};
+      bool is_end{};
+      parser.set_content_handler([&response](const fcgi::Record_header& header,
+          const std::string_view content)
+      {
+        if (header.type == 6)
+          response.append(content);
+      }).set_record_end_handler([&is_end](const fcgi::Record_header& header)
+      {
+        if (header.type == 3)
+          is_end = true;
+      }).set_management_handler([&get_values_result_count](
+          const fcgi::Record_header& header, const std::string_view content)
+      {
+        DMITIGR_ASSERT(header.type == 10);
+        DMITIGR_ASSERT(content.find("FCGI_MAX_CONNS") != std::string_view::npos);
+        ++get_values_result_count;
+      });
+      char buf[4096];
+      while (!is_end) {
+        const auto count = io->read(buf, sizeof(buf));
+        DMITIGR_ASSERT(count > 0);
+        parser.parse(buf, static_cast<std::size_t>(count));
+      }
+      DMITIGR_ASSERT(get_values_result_count == 30);
+      DMITIGR_ASSERT(response == "ok");
+    }};
+
+    {
+      const auto conn = server.accept();
+      DMITIGR_ASSERT(conn->read_body() == input);
+      conn->out() << "ok";
+    }
+    client.join();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
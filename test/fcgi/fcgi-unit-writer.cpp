@@ -0,0 +1,180 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+namespace fcgi = dmitigr::fcgi;
+namespace test = dmitigr::fcgi::test;
+
+/**
+ * @brief Writes the mix of strings of various sizes and numbers of various
+ * lengths, which is large enough to cross the end of the put area many times.
+ */
+void write_mix(fcgi::Writer& writer)
+{
+  for (std::size_t i{}; i < 20000; ++i) {
+    writer << test::sample(i, i % 53);
+    if (i % 3 == 0)
+      writer << static_cast<long long>(i * 7919) - 100000000;
+    if (i % 5 == 0)
+      writer << std::numeric_limits<std::uint64_t>::max() - i;
+    if (i % 7 == 0)
+      writer << static_cast<double>(i) / 8 << ' ' << 1.0 / (i + 3);
+  }
+}
+
+/**
+ * @brief Serves a request by `handle` at `server`.
+ *
+ * @returns The response to the request of the records `request`.
+ */
+test::Response serve(fcgi::Listener& server, const int port,
+  const std::string& request,
+  const std::function<void(fcgi::Server_connection&)>& handle)
+{
+  std::thread handler{[&server, &handle]
+  {
+    const auto conn = server.accept();
+    handle(*conn);
+  }};
+  test::Response result;
+  result.read_to_end(*test::send(port, request));
+  handler.join();
+  return result;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    std::ostringstream out;
+    out.precision(2);
+    fcgi::Writer writer{out};
+    DMITIGR_ASSERT(&writer.stream() == &out);
+    writer << "str" << ' ' << std::string_view{"view"} << ' ' << true << ' '
+           << -42 << ' ' << 42u << ' ' << std::int8_t{-8} << ' '
+           << std::numeric_limits<std::int64_t>::min() << ' '
+           << std::numeric_limits<std::uint64_t>::max() << ' '
+           << 0.1 << ' ' << 1.5f << ' ' << 1e300;
+    writer.write("!", 1).flush();
+    DMITIGR_ASSERT(out.str() == "str view true -42 42 -8 -9223372036854775808 "
+      "18446744073709551615 0.1 1.5 1e+300!");
+
+    const int port{9888};
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}};
+    server.listen();
+
+    /*
+     * The data placed straight into the put area of the output stream of the
+     * connection, and by the stream buffer at the end of the put area, is the
+     * same as written by the stream buffer only.
+     */
+    {
+      std::ostringstream expected;
+      fcgi::Writer expected_writer{expected};
+      write_mix(expected_writer);
+      const auto response = serve(server, port, test::Request{}.records(),
+        [](fcgi::Server_connection& conn)
+        {
+          fcgi::Writer writer{conn.out()};
+          write_mix(writer);
+          DMITIGR_ASSERT(conn.out().good());
+        });
+      DMITIGR_ASSERT(response.protocol_status() == 0);
+      DMITIGR_ASSERT(response.out() == expected.str());
+    }
+
+    // The writes to the closed stream fail.
+    {
+      const auto response = serve(server, port, test::Request{}.records(),
+        [](fcgi::Server_connection& conn)
+        {
+          conn.close();
+          fcgi::Writer writer{conn.out()};
+          writer << "discarded";
+          DMITIGR_ASSERT(conn.out().bad());
+          conn.out().clear();
+          writer << 42;
+          DMITIGR_ASSERT(conn.out().bad());
+        });
+      DMITIGR_ASSERT(response.protocol_status() == 0);
+      DMITIGR_ASSERT(response.out().empty());
+    }
+
+    // The output of the aborted request is discarded.
+    {
+      const auto response = serve(server, port,
+        test::Request{}.records("abc") + test::record(2),
+        [](fcgi::Server_connection& conn)
+        {
+          DMITIGR_ASSERT(conn.read_body() == "abc");
+          for (int i{}; i < 500 && !conn.poll_abort(); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+          DMITIGR_ASSERT(conn.is_aborted());
+          fcgi::Writer writer{conn.out()};
+          write_mix(writer);
+          DMITIGR_ASSERT(conn.out().good());
+        });
+      DMITIGR_ASSERT(response.is_end());
+      DMITIGR_ASSERT(response.out().empty());
+    }
+
+    /*
+     * The guarded put area (until the end of the header block) is written by
+     * the stream buffer, so the header block is flushed as a record of its own.
+     */
+    {
+      const int port{9889};
+      fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}
+        .set_flush_policy(fcgi::Flush_policy{}.set_flush_after_headers(true))};
+      server.listen();
+      std::ostringstream expected;
+      fcgi::Writer expected_writer{expected};
+      expected_writer << "Content-Length: " << 123456789 << "\r\n\r\n";
+      const auto header_block_size = expected.str().size();
+      write_mix(expected_writer);
+      const auto response = serve(server, port, test::Request{}.records(),
+        [](fcgi::Server_connection& conn)
+        {
+          fcgi::Writer writer{conn.out()};
+          writer << "Content-Length: " << 123456789 << "\r\n\r\n";
+          write_mix(writer);
+          DMITIGR_ASSERT(conn.out().good());
+        });
+      DMITIGR_ASSERT(response.protocol_status() == 0);
+      DMITIGR_ASSERT(response.out_record_sizes().front() == header_block_size);
+      DMITIGR_ASSERT(response.out() == expected.str());
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
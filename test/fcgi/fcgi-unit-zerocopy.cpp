@@ -0,0 +1,94 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fcgi-unit.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+int main()
+{
+  try {
+    namespace fcgi = dmitigr::fcgi;
+    namespace net = dmitigr::net;
+    namespace test = dmitigr::fcgi::test;
+
+    const int port{9885};
+    fcgi::Listener server{fcgi::Listener_options{"127.0.0.1", port, 64}
+      .set_zerocopy_threshold(16384)};
+    server.listen();
+
+    /*
+     * The records are written by the zero-copy writes while the client is
+     * not reading. The put buffers of the stream are reused to produce the
+     * next records only after the completion of the writes, so the received
+     * output must be intact.
+     */
+    {
+      constexpr std::size_t size{16777216};
+      const auto io = test::send(port, test::Request{}.records());
+      std::thread handler{[&server]
+      {
+        const auto conn = server.accept();
+        test::write_sample(conn->out(), size);
+      }};
+      std::this_thread::sleep_for(std::chrono::milliseconds{300});
+      DMITIGR_ASSERT(test::Response{}.read_to_end(*io).out() ==
+        test::sample(0, size));
+      handler.join();
+    }
+
+    // The zero-copy writes to the client which resets the connection.
+    {
+      constexpr std::size_t size{67108864};
+      auto io = test::send(port, test::Request{}.records());
+      bool is_failed{};
+      std::thread handler{[&server, &is_failed]
+      {
+        try {
+          const auto conn = server.accept();
+          test::write_sample(conn->out(), size);
+          conn->close();
+        } catch (const std::exception&) {
+          is_failed = true;
+        }
+      }};
+      char buf[1024];
+      DMITIGR_ASSERT(io->read(buf, sizeof(buf)) > 0);
+#ifndef _WIN32
+      const auto socket = static_cast<net::Socket_native>(io->native_handle());
+      const ::linger lin{1, 0};
+      DMITIGR_ASSERT(!::setsockopt(socket, SOL_SOCKET, SO_LINGER,
+          &lin, sizeof(lin)));
+      ::shutdown(socket, SHUT_RDWR);
+#endif
+      io.reset();
+      handler.join();
+      DMITIGR_ASSERT(is_failed);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (...) {
+    std::cerr << "unknown error" << std::endl;
+    return 2;
+  }
+}
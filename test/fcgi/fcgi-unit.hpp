@@ -0,0 +1,301 @@
+// -*- C++ -*-
+//
+// Copyright 2022 Dmitry Igrishin
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DMITIGR_FCGI_TEST_UNIT_HPP
+#define DMITIGR_FCGI_TEST_UNIT_HPP
+
+#include "../../src/base/assert.hpp"
+#include "../../src/fcgi/fcgi.hpp"
+#include "../../src/net/client.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dmitigr::fcgi::test {
+
+/// The ID of the requests of the tests.
+constexpr int request_id{1};
+
+/**
+ * @returns The record of the given `type` of the request `id` (`0` denotes the
+ * management record).
+ */
+inline std::string record(const int type, const std::string_view content = {},
+  const int id = request_id)
+{
+  const auto padding_length = (8 - content.size() % 8) % 8;
+  std::string result{'\1', static_cast<char>(type),
+    static_cast<char>(id >> 8), static_cast<char>(id),
+    static_cast<char>(content.size() >> 8), static_cast<char>(content.size()),
+    static_cast<char>(padding_length), '\0'};
+  return result.append(content).append(padding_length, '\0');
+}
+
+/// The builder of the records of the request `request_id`.
+class Request final {
+public:
+  /// The constructor.
+  explicit Request(const Role role = Role::responder,
+    const bool is_keep_conn = false)
+    : records_{record(1, std::string{'\0', static_cast<char>(role),
+      static_cast<char>(is_keep_conn)}.append(5, '\0'))}
+  {}
+
+  /// Appends the parameter.
+  Request& param(const std::string_view name, const std::string_view value)
+  {
+    for (const auto size : {name.size(), value.size()}) {
+      if (size < 128)
+        params_ += static_cast<char>(size);
+      else
+        params_.append({static_cast<char>(size >> 24 | 0x80),
+          static_cast<char>(size >> 16), static_cast<char>(size >> 8),
+          static_cast<char>(size)});
+    }
+    params_.append(name).append(value);
+    return *this;
+  }
+
+  /// @returns The records up to the end of the stream of parameters.
+  std::string begin() const
+  {
+    return records_ + stream(4, params_);
+  }
+
+  /**
+   * @returns The records of the whole request with the input stream `in`
+   * followed by the data stream `data` (if any).
+   */
+  std::string records(const std::string_view in = {},
+    const std::optional<std::string_view> data = {}) const
+  {
+    auto result = begin() + stream(5, in);
+    return data ? result + stream(8, *data) : result;
+  }
+
+  /**
+   * @returns The records of the stream of the given `type` with the `content`,
+   * terminated by the empty record.
+   */
+  static std::string stream(const int type, const std::string_view content)
+  {
+    std::string result;
+    constexpr std::size_t max_content_length{65528};
+    for (std::size_t i{}; i < content.size(); i += max_content_length)
+      result.append(record(type, content.substr(i, max_content_length)));
+    return result.append(record(type));
+  }
+
+private:
+  std::string records_;
+  std::string params_;
+};
+
+/// Writes the `data` to `io`.
+inline void send(net::Descriptor& io, std::string_view data)
+{
+  while (!data.empty()) {
+    const auto count = io.write(data.data(),
+      static_cast<std::streamsize>(data.size()));
+    DMITIGR_ASSERT(count > 0);
+    data.remove_prefix(static_cast<std::size_t>(count));
+  }
+}
+
+/**
+ * @brief Connects to the Listener at `port` of the local host and sends the
+ * `data`.
+ *
+ * @returns The connection.
+ */
+inline std::unique_ptr<net::Descriptor> send(const int port,
+  const std::string_view data)
+{
+  auto result = net::make_tcp_connection({"127.0.0.1", port});
+  send(*result, data);
+  return result;
+}
+
+/// @returns The `size` bytes of the sample content starting from `offset`.
+inline std::string sample(const std::size_t offset, const std::size_t size)
+{
+  std::string result(size, '\0');
+  for (std::size_t i{}; i < size; ++i)
+    result[i] = static_cast<char>('a' + (offset + i) % 26);
+  return result;
+}
+
+/**
+ * @brief Writes the `size` bytes of the sample content to `out` by chunks,
+ * counting them in `written`.
+ */
+inline void write_sample(std::ostream& out, const std::size_t size,
+  std::atomic_size_t& written)
+{
+  constexpr std::size_t chunk_size{100000};
+  while (written < size) {
+    const auto count = std::min(chunk_size, size - written);
+    out << sample(written, count);
+    written += count;
+  }
+}
+
+/// @overload
+inline void write_sample(std::ostream& out, const std::size_t size)
+{
+  std::atomic_size_t written{};
+  write_sample(out, size, written);
+}
+
+/**
+ * @brief The incremental parser of the response to the request `request_id`
+ * (and of the management records).
+ */
+class Response final {
+public:
+  /// Parses the next `size` bytes of the response.
+  void parse(const char* const data, const std::size_t size)
+  {
+    unparsed_.append(data, size);
+    std::size_t offset{};
+    while (unparsed_.size() - offset >= 8) {
+      const auto* const header =
+        reinterpret_cast<const unsigned char*>(unparsed_.data() + offset);
+      DMITIGR_ASSERT(header[0] == 1);
+      const int id{header[2] << 8 | header[3]};
+      DMITIGR_ASSERT(id == request_id || !id);
+      const std::size_t content_length = header[4] << 8 | header[5];
+      const std::size_t record_length = 8 + content_length + header[6];
+      if (unparsed_.size() - offset < record_length)
+        break;
+
+      const std::string_view content{unparsed_.data() + offset + 8,
+        content_length};
+      if (!id) {
+        management_records_.push_back(record(header[1], content, id));
+        offset += record_length;
+        continue;
+      }
+
+      DMITIGR_ASSERT(!is_end_);
+      if (header[1] == 6) {
+        out_.append(content);
+        out_record_sizes_.push_back(content_length);
+      }
+      else if (header[1] == 7)
+        err_.append(content);
+      else if (header[1] == 3) {
+        DMITIGR_ASSERT(content_length == 8);
+        const auto* const body =
+          reinterpret_cast<const unsigned char*>(content.data());
+        application_status_ = static_cast<int>(static_cast<unsigned>(
+          body[0] << 24 | body[1] << 16 | body[2] << 8 | body[3]));
+        protocol_status_ = body[4];
+        is_end_ = true;
+      }
+      offset += record_length;
+    }
+    unparsed_.erase(0, offset);
+  }
+
+  /**
+   * @brief Reads the next part of the response from `io`.
+   *
+   * @returns `false` if the connection is closed by the server.
+   */
+  bool read(net::Descriptor& io)
+  {
+    char buf[65536];
+    const auto count = io.read(buf, sizeof(buf));
+    DMITIGR_ASSERT(count >= 0);
+    parse(buf, static_cast<std::size_t>(count));
+    return count > 0;
+  }
+
+  /// Reads the rest of the response from `io`.
+  Response& read_to_end(net::Descriptor& io)
+  {
+    while (!is_end_)
+      DMITIGR_ASSERT(read(io));
+    return *this;
+  }
+
+  /// @returns The content of the output stream received so far.
+  const std::string& out() const noexcept
+  {
+    return out_;
+  }
+
+  /**
+   * @returns The content lengths of the records of the output stream received
+   * so far (including the empty record which terminates the stream).
+   */
+  const std::vector<std::size_t>& out_record_sizes() const noexcept
+  {
+    return out_record_sizes_;
+  }
+
+  /// @returns The management records received so far.
+  const std::vector<std::string>& management_records() const noexcept
+  {
+    return management_records_;
+  }
+
+  /// @returns The content of the error stream received so far.
+  const std::string& err() const noexcept
+  {
+    return err_;
+  }
+
+  /// @returns `true` if the end-request record is received.
+  bool is_end() const noexcept
+  {
+    return is_end_;
+  }
+
+  /// @returns The application status of the end-request record.
+  int application_status() const noexcept
+  {
+    return application_status_;
+  }
+
+  /// @returns The protocol status of the end-request record.
+  int protocol_status() const noexcept
+  {
+    return protocol_status_;
+  }
+
+private:
+  std::string unparsed_;
+  std::string out_;
+  std::vector<std::size_t> out_record_sizes_;
+  std::string err_;
+  std::vector<std::string> management_records_;
+  bool is_end_{};
+  int application_status_{};
+  int protocol_status_{-1};
+};
+
+} // namespace dmitigr::fcgi::test
+
+#endif  // DMITIGR_FCGI_TEST_UNIT_HPP
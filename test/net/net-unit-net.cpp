@@ -17,6 +17,10 @@
 #include "../../src/base/assert.hpp"
 #include "../../src/net/net.hpp"
 
+#include <array>
+#include <string>
+#include <thread>
+
 int main()
 {
   try {
@@ -52,6 +56,71 @@ int main()
     DMITIGR_ASSERT(f != f1);
     f1 = net::conv(f1);
     DMITIGR_ASSERT(f == f1);
+
+    // Scatter/gather I/O.
+    {
+      int fds[2];
+      DMITIGR_ASSERT(!::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+      net::detail::socket_Descriptor wr{net::Socket_guard{fds[0]}};
+      net::detail::socket_Descriptor rd{net::Socket_guard{fds[1]}};
+
+      const std::string hello{"Hello, "};
+      const std::string world{"World!"};
+      std::array<net::Iovec, 3> out{net::make_iovec(hello.data(), hello.size()),
+        net::make_iovec(nullptr, 0), net::make_iovec(world.data(), world.size())};
+      net::write_all(wr, out.data(), out.size());
+      DMITIGR_ASSERT(!out[2].iov_len);
+
+      std::string h(5, '\0');
+      std::string w(8, '\0');
+      const std::array<net::Iovec, 2> in{net::make_iovec(h.data(), h.size()),
+        net::make_iovec(w.data(), w.size())};
+      const auto count = rd.readv(in.data(), in.size());
+      DMITIGR_ASSERT(count == 13);
+      DMITIGR_ASSERT(h == "Hello");
+      DMITIGR_ASSERT(w == ", World!");
+    }
+
+    // Short writes to non-blocking socket.
+    {
+      int fds[2];
+      DMITIGR_ASSERT(!::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+      constexpr int buffer_size{4096};
+      DMITIGR_ASSERT(!::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF,
+          &buffer_size, sizeof(buffer_size)));
+      net::set_nonblocking(fds[0], true);
+      net::set_nonblocking(fds[1], true);
+      net::detail::socket_Descriptor wr{net::Socket_guard{fds[0]}};
+      net::detail::socket_Descriptor rd{net::Socket_guard{fds[1]}};
+
+      char ch{};
+      DMITIGR_ASSERT(rd.read(&ch, 1) == -1); // would block
+
+      std::string data(1048576, '\0');
+      for (std::size_t i{}; i < data.size(); ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+      const auto size = static_cast<std::streamsize>(data.size());
+      const auto written = wr.write(data.data(), size);
+      DMITIGR_ASSERT(0 < written && written < size);
+      DMITIGR_ASSERT(!wr.write(data.data() + written, size - written));
+
+      std::string received;
+      std::thread reader{[&rd, &received, size]
+      {
+        net::set_nonblocking(static_cast<net::Socket_native>(
+          rd.native_handle()), false);
+        std::array<char, 65536> buf;
+        while (static_cast<std::streamsize>(received.size()) < size) {
+          const auto count = rd.read(buf.data(),
+            static_cast<std::streamsize>(buf.size()));
+          DMITIGR_ASSERT(count > 0);
+          received.append(buf.data(), static_cast<std::size_t>(count));
+        }
+      }};
+      net::write_all(wr, data.data() + written, size - written);
+      reader.join();
+      DMITIGR_ASSERT(received == data);
+    }
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
     return 1;